@@ -0,0 +1,122 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+#include "krazymeans.h"
+#include "../krazy/KrazyMeans.hpp"
+
+// Whether a struct that starts with its size holds a field, so callers compiled against older headers are supported.
+#define KM_HAS_FIELD(ptr, type, field) ((ptr)->struct_size >= offsetof(type, field) + sizeof((ptr)->field))
+
+void km_options_init(km_options *options, size_t struct_size) {
+  if ((options == nullptr) || (struct_size < sizeof(size_t))) return;
+  km_options defaults;
+  defaults.struct_size = std::min(struct_size, sizeof(km_options));
+  defaults.num_clusters = 4;
+  defaults.scale_threshold_iterations = 64;
+  defaults.scale_factor = 1e-5f;
+  defaults.num_threads = 0;
+  defaults.assignment = KM_ASSIGNMENT_AUTO;
+  defaults.seed = 0;
+  defaults.max_changed_fraction = 0.0;
+  defaults.max_centroid_shift = 0.0f;
+  defaults.max_iterations = 0;
+  defaults.time_budget = 0.0;
+  std::copy((const char *) &defaults, (const char *) &defaults + defaults.struct_size, (char *) options);
+}
+
+static km_stop_reason toStopReason(KrazyMeans::StopReason reason) {
+  switch (reason) {
+    case KrazyMeans::StopReason::Converged: return KM_STOP_CONVERGED;
+    case KrazyMeans::StopReason::ChangedLabels: return KM_STOP_CHANGED_LABELS;
+    case KrazyMeans::StopReason::CentroidShift: return KM_STOP_CENTROID_SHIFT;
+    case KrazyMeans::StopReason::MaxIterations: return KM_STOP_MAX_ITERATIONS;
+    case KrazyMeans::StopReason::TimeBudget: return KM_STOP_TIME_BUDGET;
+    default: return KM_STOP_NONE;
+  }
+}
+
+km_status km_cluster(const float *data,
+                     size_t num_vectors,
+                     size_t num_features,
+                     size_t stride,
+                     const km_options *options,
+                     size_t *labels,
+                     float *centroids,
+                     km_result *result) {
+  if ((data == nullptr) || (options == nullptr) || (num_vectors == 0) || (num_features == 0)
+      || (stride < num_features) || !KM_HAS_FIELD(options, km_options, assignment) || (options->num_clusters == 0)) {
+    return KM_ERROR_INVALID_ARGUMENT;
+  }
+
+  try {
+    // KrazyMeans never writes to the data set, so the caller's buffer can be wrapped as is.
+    auto ds = DataSet::wrap(const_cast<float *>(data), num_vectors, num_features, stride);
+
+    KrazyMeans km(ds, options->num_clusters, options->scale_threshold_iterations, options->scale_factor);
+    km.num_threads = options->num_threads;
+    switch (options->assignment) {
+      case KM_ASSIGNMENT_AUTO: km.assignment = KrazyMeans::Assignment::Auto;
+        break;
+      case KM_ASSIGNMENT_NAIVE: km.assignment = KrazyMeans::Assignment::Naive;
+        break;
+      case KM_ASSIGNMENT_KD_TREE: km.assignment = KrazyMeans::Assignment::KdTree;
+        break;
+      default: return KM_ERROR_INVALID_ARGUMENT;
+    }
+    if (KM_HAS_FIELD(options, km_options, seed)) km.seed = options->seed;
+    if (KM_HAS_FIELD(options, km_options, max_changed_fraction)) {
+      km.stopping.max_changed_fraction = options->max_changed_fraction;
+    }
+    if (KM_HAS_FIELD(options, km_options, max_centroid_shift)) {
+      km.stopping.max_centroid_shift = options->max_centroid_shift;
+    }
+    if (KM_HAS_FIELD(options, km_options, max_iterations)) km.stopping.max_iterations = options->max_iterations;
+    if (KM_HAS_FIELD(options, km_options, time_budget)) km.stopping.time_budget = options->time_budget;
+
+    km.initialize();
+    km.run();
+
+    if (labels != nullptr) {
+      std::copy(km.labels.begin(), km.labels.end(), labels);
+    }
+    if (centroids != nullptr) {
+      for (size_t c = 0; c < km.centroids.size(); c++) {
+        std::copy(km.centroids[c].values.begin(), km.centroids[c].values.end(), centroids + c * num_features);
+      }
+    }
+    if (result != nullptr) {
+      if (KM_HAS_FIELD(result, km_result, iterations)) result->iterations = km.iteration;
+      if (KM_HAS_FIELD(result, km_result, stop_reason)) result->stop_reason = toStopReason(km.stop_reason);
+    }
+    return KM_OK;
+  } catch (std::bad_alloc &e) {
+    return KM_ERROR_OUT_OF_MEMORY;
+  } catch (...) {
+    return KM_ERROR_INTERNAL;
+  }
+}
+
+const char *km_status_string(km_status status) {
+  switch (status) {
+    case KM_OK: return "Success.";
+    case KM_ERROR_INVALID_ARGUMENT: return "Invalid argument.";
+    case KM_ERROR_OUT_OF_MEMORY: return "Out of memory.";
+    case KM_ERROR_INTERNAL: return "Internal error.";
+    default: return "Unknown status.";
+  }
+}
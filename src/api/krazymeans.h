@@ -0,0 +1,155 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file krazymeans.h
+ * @brief C API of libkrazymeans.
+ *
+ * Clusters feature vectors that are held in memory by the caller. The feature values are used in place, they are
+ * not copied, except by the k-d tree assignment: it keeps a copy of the vectors in tree order. The k-d tree is used
+ * with KM_ASSIGNMENT_KD_TREE, and with KM_ASSIGNMENT_AUTO for data with at most 8 features. Results are written to
+ * memory provided by the caller.
+ *
+ * The option and result structs start with their size, so that fields can be added to their end without breaking
+ * callers that were compiled against an older version of this header.
+ */
+
+#ifndef KRAZYMEANS_H
+#define KRAZYMEANS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define KM_API __attribute__((visibility("default")))
+#else
+#define KM_API
+#endif
+
+/** @brief Version of the C API. Incremented on incompatible changes. */
+#define KM_API_VERSION 2
+
+/** @brief Result of a libkrazymeans call. */
+typedef enum km_status {
+  KM_OK = 0,
+  /** @brief An argument was invalid, e.g. a null pointer or zero clusters. */
+  KM_ERROR_INVALID_ARGUMENT = 1,
+  /** @brief Memory could not be allocated. */
+  KM_ERROR_OUT_OF_MEMORY = 2,
+  /** @brief Any other error. */
+  KM_ERROR_INTERNAL = 3
+} km_status;
+
+/** @brief Strategies to assign feature vectors to centroids. */
+typedef enum km_assignment {
+  /** @brief Use the k-d tree for data with few features, the naive assignment otherwise. */
+  KM_ASSIGNMENT_AUTO = 0,
+  KM_ASSIGNMENT_NAIVE = 1,
+  KM_ASSIGNMENT_KD_TREE = 2
+} km_assignment;
+
+/** @brief The reasons for the clustering to stop. */
+typedef enum km_stop_reason {
+  /** @brief The clustering did not run. */
+  KM_STOP_NONE = 0,
+  /** @brief No labels changed. */
+  KM_STOP_CONVERGED = 1,
+  /** @brief The fraction of changed labels dropped to km_options::max_changed_fraction. */
+  KM_STOP_CHANGED_LABELS = 2,
+  /** @brief The centroid shift dropped to km_options::max_centroid_shift. */
+  KM_STOP_CENTROID_SHIFT = 3,
+  /** @brief km_options::max_iterations was reached. */
+  KM_STOP_MAX_ITERATIONS = 4,
+  /** @brief km_options::time_budget was exceeded. */
+  KM_STOP_TIME_BUDGET = 5
+} km_stop_reason;
+
+/** @brief Clustering options. Initialize with km_options_init. */
+typedef struct km_options {
+  /** @brief The size of this struct in bytes, set by km_options_init. */
+  size_t struct_size;
+  /** @brief The number of clusters. */
+  unsigned int num_clusters;
+  /** @brief The iteration threshold before starting distance scaling. */
+  unsigned int scale_threshold_iterations;
+  /** @brief The factor at which to scale the distance per iteration after the threshold. */
+  float scale_factor;
+  /** @brief The number of threads. Zero uses all hardware threads. */
+  unsigned int num_threads;
+  /** @brief The assignment strategy. */
+  km_assignment assignment;
+  /** @brief The seed for the random selection of the initial centroids. */
+  int seed;
+  /** @brief Stop when at most this fraction of the labels changed in an iteration. Zero disables the rule. */
+  double max_changed_fraction;
+  /** @brief Stop when no centroid moved further than this distance in an iteration. Zero disables the rule. */
+  float max_centroid_shift;
+  /** @brief Stop after this number of iterations. Zero disables the rule. */
+  unsigned int max_iterations;
+  /** @brief Stop after this number of seconds. Zero disables the rule. */
+  double time_budget;
+} km_options;
+
+/** @brief The outcome of a clustering. */
+typedef struct km_result {
+  /** @brief The size of this struct in bytes. Must be set by the caller. */
+  size_t struct_size;
+  /** @brief The number of iterations. */
+  unsigned int iterations;
+  /** @brief The reason the clustering stopped. */
+  km_stop_reason stop_reason;
+} km_result;
+
+/**
+ * @brief Fill \p options with the defaults of the krazymeans program.
+ *
+ * @param options       The options to fill.
+ * @param struct_size   The size of \p options, sizeof(km_options). Only fields within this size are written.
+ */
+KM_API void km_options_init(km_options *options, size_t struct_size);
+
+/**
+ * @brief Cluster feature vectors until convergence, or until one of the stopping rules applies.
+ *
+ * @param data          The features of the first vector. Not modified, and not accessed after the call returns.
+ * @param num_vectors   The number of vectors.
+ * @param num_features  The number of features per vector.
+ * @param stride        The distance between consecutive vectors, in floats. At least \p num_features.
+ * @param options       The clustering options.
+ * @param labels        Output: the label of every vector, num_vectors elements. May be NULL.
+ * @param centroids     Output: the row-major centroids, num_clusters * num_features elements. May be NULL.
+ * @param result        Output: the number of iterations and the stop reason. May be NULL. Its struct_size must be
+ *                      set, only fields within that size are written.
+ * @return KM_OK on success.
+ */
+KM_API km_status km_cluster(const float *data,
+                            size_t num_vectors,
+                            size_t num_features,
+                            size_t stride,
+                            const km_options *options,
+                            size_t *labels,
+                            float *centroids,
+                            km_result *result);
+
+/** @brief Return a description of \p status. */
+KM_API const char *km_status_string(km_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // KRAZYMEANS_H
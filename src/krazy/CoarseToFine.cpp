@@ -0,0 +1,162 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <numeric>
+
+#include "CoarseToFine.hpp"
+#include "../utils/Timer.hpp"
+
+// Derive the rules for the next stage from the rules of the whole run. The iteration cap and the time budget are
+// reduced by what the previous stages used. Returns the rule that leaves nothing for the next stage, if any.
+static KrazyMeans::StopReason limitStage(const KrazyMeans::StoppingRules &rules,
+                                         unsigned int iterations,
+                                         double seconds,
+                                         KrazyMeans::StoppingRules &stage) {
+  stage = rules;
+  if (rules.max_iterations != 0) {
+    if (iterations >= rules.max_iterations) return KrazyMeans::StopReason::MaxIterations;
+    stage.max_iterations = rules.max_iterations - iterations;
+  }
+  if (rules.time_budget > 0.0) {
+    if (seconds >= rules.time_budget) return KrazyMeans::StopReason::TimeBudget;
+    stage.time_budget = rules.time_budget - seconds;
+  }
+  return KrazyMeans::StopReason::None;
+}
+
+void CoarseToFine::run(KrazyMeans &km) {
+  auto &full = km.data_set;
+  auto size = full->size();
+  stages.clear();
+
+  // Shuffle the vector indices once. Every sample is a prefix, so the samples are nested. The time it takes is
+  // counted as part of the first stage.
+  Timer t;
+  t.start();
+  std::vector<size_t> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  UniformRandomGenerator<long> rg(km.seed);
+  for (size_t i = 0; i + 1 < size; i++) {
+    std::swap(order[i], order[i + rg.next() % (size - i)]);
+  }
+
+  t.stop();
+  auto setup_seconds = t.seconds();
+
+  std::vector<FeatureVec> centroids;
+  auto rules = km.stopping;
+  KrazyMeans::StoppingRules stage_rules;
+
+  // Every sample is gathered in the same memory, sized for the largest one, and clustered with the same context, so
+  // the stages reuse the labels, centroids and k-d tree of the previous ones.
+  auto F = full->num_features;
+  size_t largest = 0;
+  for (auto fraction : fractions) {
+    largest = std::max(largest, std::min(size, (size_t) (fraction * (double) size)));
+  }
+  std::vector<size_t> indices(largest);
+  std::vector<float> sample_values(largest * F);
+  std::unique_ptr<KrazyMeans> stage;
+
+  for (auto fraction : fractions) {
+    auto n = std::min(size, (size_t) (fraction * (double) size));
+    // A sample needs at least one vector per cluster.
+    if (n < km.num_clusters) continue;
+    // Skip the remaining samples when the budget is used up.
+    if (limitStage(rules, totalIterations(), totalSeconds() + setup_seconds * stages.empty(), stage_rules)
+        != KrazyMeans::StopReason::None) {
+      break;
+    }
+
+    t.start();
+    // Gather the sample in the order of the data set, for locality.
+    std::copy(order.begin(), order.begin() + n, indices.begin());
+    std::sort(indices.begin(), indices.begin() + n);
+    for (size_t i = 0; i < n; i++) {
+      std::copy(full->vector(indices[i]), full->vector(indices[i]) + F, &sample_values[i * F]);
+    }
+    auto sample = DataSet::wrap(sample_values.data(), n, F, F);
+
+    if (stage) {
+      stage->reset(sample, km.num_clusters, km.scale_threshold_iterations, km.scale_factor);
+    } else {
+      stage.reset(new KrazyMeans(sample, km.num_clusters, km.scale_threshold_iterations, km.scale_factor));
+      stage->seed = km.seed;
+      stage->assignment = km.assignment;
+      stage->num_threads = km.num_threads;
+      stage->profile = km.profile;
+    }
+    stage->stopping = stage_rules;
+    if (centroids.empty()) {
+      stage->initialize();
+    } else {
+      stage->initialize(centroids);
+    }
+    stage->run();
+    centroids = stage->centroids;
+    t.stop();
+
+    Stage s;
+    s.num_vectors = n;
+    s.iterations = stage->iteration;
+    s.seconds = t.seconds() + (stages.empty() ? setup_seconds : 0.0);
+    stages.push_back(s);
+  }
+
+  // Refine on the full data set. When the budget is used up, only assign the vectors to the centroids.
+  auto exhausted = limitStage(rules, totalIterations(), totalSeconds() + setup_seconds * stages.empty(), stage_rules);
+  t.start();
+  if (centroids.empty()) {
+    km.initialize();
+  } else {
+    km.initialize(centroids);
+  }
+  if (exhausted == KrazyMeans::StopReason::None) {
+    km.stopping = stage_rules;
+    km.run();
+    km.stopping = rules;
+  } else {
+    km.stop_reason = exhausted;
+    km.converged = true;
+  }
+  t.stop();
+
+  Stage s;
+  s.num_vectors = size;
+  s.iterations = km.iteration;
+  s.seconds = t.seconds() + (stages.empty() ? setup_seconds : 0.0);
+  stages.push_back(s);
+}
+
+unsigned int CoarseToFine::totalIterations() const {
+  unsigned int total = 0;
+  for (auto &s : stages) total += s.iterations;
+  return total;
+}
+
+double CoarseToFine::totalSeconds() const {
+  double total = 0.0;
+  for (auto &s : stages) total += s.seconds;
+  return total;
+}
+
+void CoarseToFine::report(std::ostream &os) const {
+  for (size_t i = 0; i < stages.size(); i++) {
+    os << "Stage " << i << " (" << stages[i].num_vectors << " vectors) : " << stages[i].iterations << " iterations, "
+       << stages[i].seconds << " s." << std::endl;
+  }
+  os << "Total iterations          : " << totalIterations() << std::endl;
+  os << "Total time                : " << totalSeconds() << " s." << std::endl;
+}
@@ -0,0 +1,68 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include "KrazyMeans.hpp"
+
+/**
+ * @brief Coarse-to-fine clustering: converge on random samples of the data set first.
+ *
+ * The first stage clusters a small random sample, starting from random centroids. Every next stage clusters a larger
+ * sample, starting from the centroids of the previous stage. Finally, the full data set is clustered starting from
+ * the centroids of the last sample. Samples are nested: every sample contains the smaller ones. Every stage, including
+ * the final one, starts at iteration zero and applies the usual threshold and scaling rules.
+ */
+struct CoarseToFine {
+  ///@brief The statistics of a single stage. The time of the first stage includes shuffling the data set.
+  struct Stage {
+    size_t num_vectors = 0;
+    unsigned int iterations = 0;
+    double seconds = 0.0;
+  };
+
+  ///@brief The sizes of the samples as fractions of the data set, in increasing order.
+  std::vector<double> fractions;
+
+  ///@brief The statistics of all stages, the last one being the full data set.
+  std::vector<Stage> stages;
+
+  ///@brief Construct a new coarse-to-fine run with samples of \p fractions of the data set.
+  explicit CoarseToFine(std::vector<double> fractions) : fractions(std::move(fractions)) {}
+
+  /**
+   * @brief Cluster the data set of \p km in stages.
+   *
+   * The sample stages use the same parameters as \p km. When this returns, \p km has converged on the full data set.
+   *
+   * The stopping rules of \p km on the changed labels and the centroid shift apply to every stage. The iteration cap
+   * and the time budget bound all stages together, including the shuffling of the data set. Once they are used up,
+   * the remaining samples are skipped, and the full data set is only assigned to the centroids found so far.
+   *
+   * @param km A KrazyMeans context for the full data set.
+   */
+  void run(KrazyMeans &km);
+
+  ///@brief Return the total number of iterations over all stages.
+  unsigned int totalIterations() const;
+
+  ///@brief Return the total time of all stages in seconds.
+  double totalSeconds() const;
+
+  ///@brief Print the statistics of all stages.
+  void report(std::ostream &os = std::cout) const;
+};
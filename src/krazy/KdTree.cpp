@@ -0,0 +1,265 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <numeric>
+
+#include "KdTree.hpp"
+
+void KdTree::build(DataSet &data_set) {
+  num_features = data_set.num_features;
+  auto size = data_set.size();
+
+  order.resize(size);
+  std::iota(order.begin(), order.end(), 0);
+  nodes.clear();
+  bounds.clear();
+  sums.clear();
+  depth = 0;
+
+  if (size > 0) {
+    buildNode(data_set, 0, size, 1);
+  }
+
+  // Store the vectors in tree order, so the vectors of a node are contiguous.
+  points.resize(size * num_features);
+  for (size_t i = 0; i < size; i++) {
+    std::copy(data_set.vector(order[i]), data_set.vector(order[i]) + num_features, &points[i * num_features]);
+  }
+
+  clearLabels();
+}
+
+void KdTree::clearLabels() {
+  // Nothing is known about the labels yet.
+  node_labels.assign(nodes.size(), -1);
+}
+
+size_t KdTree::buildNode(DataSet &data_set, size_t begin, size_t end, size_t d) {
+  auto F = num_features;
+  auto index = nodes.size();
+  depth = std::max(depth, d);
+
+  Node node;
+  node.begin = begin;
+  node.end = end;
+  nodes.push_back(node);
+
+  // Calculate the bounding box and sum of the vectors in this node.
+  bounds.resize((index + 1) * 2 * F);
+  sums.resize((index + 1) * F);
+  auto min = &bounds[index * 2 * F];
+  auto max = min + F;
+  auto sum = &sums[index * F];
+  std::copy(data_set.vector(order[begin]), data_set.vector(order[begin]) + F, min);
+  std::copy(data_set.vector(order[begin]), data_set.vector(order[begin]) + F, max);
+  std::fill(sum, sum + F, 0.0);
+  for (size_t i = begin; i < end; i++) {
+    auto vec = data_set.vector(order[i]);
+    for (size_t f = 0; f < F; f++) {
+      min[f] = std::min(min[f], vec[f]);
+      max[f] = std::max(max[f], vec[f]);
+      sum[f] += vec[f];
+    }
+  }
+
+  if (end - begin <= leaf_size) {
+    return index;
+  }
+
+  // Split at the median of the dimension with the largest extent.
+  size_t split_dim = 0;
+  for (size_t f = 1; f < F; f++) {
+    if (max[f] - min[f] > max[split_dim] - min[split_dim]) {
+      split_dim = f;
+    }
+  }
+  if (max[split_dim] == min[split_dim]) {
+    // All vectors are identical.
+    return index;
+  }
+
+  auto mid = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                   [&data_set, split_dim](size_t a, size_t b) {
+                     return data_set.vector(a)[split_dim] < data_set.vector(b)[split_dim];
+                   });
+
+  auto left = buildNode(data_set, begin, mid, d + 1);
+  auto right = buildNode(data_set, mid, end, d + 1);
+  nodes[index].left = left;
+  nodes[index].right = right;
+  return index;
+}
+
+size_t KdTree::assign(const std::vector<FeatureVec> &centroids,
+                      float factor,
+                      std::vector<size_t> &labels,
+                      std::vector<double> &sums,
+                      std::vector<size_t> &counts) {
+  auto F = num_features;
+  num_clusters = centroids.size();
+  this->factor = factor;
+
+  centroid_values.resize(num_clusters * F);
+  for (size_t c = 0; c < num_clusters; c++) {
+    std::copy(centroids[c].values.begin(), centroids[c].values.end(), &centroid_values[c * F]);
+  }
+
+  sums.assign(num_clusters * F, 0.0);
+  counts.assign(num_clusters, 0);
+  labels_ = labels.data();
+  sums_ = sums.data();
+  counts_ = counts.data();
+  changed = 0;
+
+  // Every level of the tree has its own list of candidates, starting with all centroids at the root.
+  candidates.resize((depth + 1) * num_clusters);
+  std::iota(candidates.begin(), candidates.begin() + num_clusters, 0);
+  scratch.resize(F);
+
+  if (!nodes.empty() && (num_clusters > 0)) {
+    filter(0, num_clusters, 0);
+  }
+  return changed;
+}
+
+float KdTree::squaredDistance(const float *a, const float *b) {
+  float dist = 0.0f;
+  for (size_t f = 0; f < num_features; f++) {
+    float d = a[f] - b[f];
+    dist += d * d;
+  }
+  return dist;
+}
+
+bool KdTree::isDominated(size_t node, size_t c, size_t best) {
+  auto F = num_features;
+  auto min = &bounds[node * 2 * F];
+  auto max = min + F;
+  auto zc = &centroid_values[c * F];
+  auto zb = &centroid_values[best * F];
+
+  // Check the corner of the bounding box that lies furthest in the direction of c, as seen from best.
+  for (size_t f = 0; f < F; f++) {
+    scratch[f] = zc[f] > zb[f] ? max[f] : min[f];
+  }
+  // Strictly, so identical centroids are never dropped, like the first one wins in the exhaustive search.
+  return squaredDistance(zc, scratch.data()) > squaredDistance(zb, scratch.data());
+}
+
+void KdTree::assignNode(size_t node, size_t c) {
+  auto F = num_features;
+  auto &n = nodes[node];
+  for (size_t i = n.begin; i < n.end; i++) {
+    auto v = order[i];
+    if (labels_[v] != c) {
+      labels_[v] = c;
+      changed++;
+    }
+  }
+  counts_[c] += n.end - n.begin;
+  for (size_t f = 0; f < F; f++) {
+    sums_[c * F + f] += sums[node * F + f];
+  }
+}
+
+void KdTree::markNode(size_t node, long label) {
+  node_labels[node] = label;
+  if (nodes[node].left != 0) {
+    markNode(nodes[node].left, label);
+    markNode(nodes[node].right, label);
+  }
+}
+
+long KdTree::filter(size_t node, size_t num_candidates, size_t d) {
+  auto F = num_features;
+  auto &n = nodes[node];
+  auto current = &candidates[d * num_clusters];
+
+  // Leaves test every vector against the remaining candidates.
+  if (n.left == 0) {
+    long node_label = -2;
+    for (size_t i = n.begin; i < n.end; i++) {
+      auto v = order[i];
+      auto vec = &points[i * F];
+      float closest = INFINITY;
+      size_t index = 0;
+      for (size_t k = 0; k < num_candidates; k++) {
+        auto c = current[k];
+        float dist = calculateEuclideanDistance(vec, &centroid_values[c * F], F);
+        // Penalize potential swapping of labels with a factor
+        if (labels_[v] != c) {
+          dist = dist * factor;
+        }
+        if (dist < closest) {
+          closest = dist;
+          index = c;
+        }
+      }
+      if (labels_[v] != index) {
+        labels_[v] = index;
+        changed++;
+      }
+      counts_[index]++;
+      for (size_t f = 0; f < F; f++) {
+        sums_[index * F + f] += vec[f];
+      }
+      node_label = ((node_label == -2) || (node_label == (long) index)) ? (long) index : -1;
+    }
+    node_labels[node] = node_label;
+    return node_label;
+  }
+
+  // Find the candidate closest to the center of the bounding box.
+  auto min = &bounds[node * 2 * F];
+  auto max = min + F;
+  for (size_t f = 0; f < F; f++) {
+    scratch[f] = 0.5f * (min[f] + max[f]);
+  }
+  size_t best = current[0];
+  float closest = INFINITY;
+  for (size_t k = 0; k < num_candidates; k++) {
+    float dist = squaredDistance(scratch.data(), &centroid_values[current[k] * F]);
+    if (dist < closest) {
+      closest = dist;
+      best = current[k];
+    }
+  }
+
+  // Drop candidates that are farther away than best for all of the node. A candidate that is the current label of
+  // any vector in the node can't be dropped when distances are scaled, since its own distance is not scaled.
+  auto label = node_labels[node];
+  auto next = &candidates[(d + 1) * num_clusters];
+  size_t num_next = 0;
+  for (size_t k = 0; k < num_candidates; k++) {
+    auto c = current[k];
+    bool is_label = (factor != 1.0f) && ((label < 0) || (label == (long) c));
+    if ((c == best) || is_label || !isDominated(node, c, best)) {
+      next[num_next++] = c;
+    }
+  }
+
+  if (num_next == 1) {
+    assignNode(node, best);
+    markNode(node, (long) best);
+    return (long) best;
+  }
+
+  auto left_label = filter(n.left, num_next, d + 1);
+  auto right_label = filter(n.right, num_next, d + 1);
+  label = left_label == right_label ? left_label : -1;
+  node_labels[node] = label;
+  return label;
+}
@@ -0,0 +1,131 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../utils/DataSet.hpp"
+#include "../utils/FeatureVec.hpp"
+
+/**
+ * @brief A k-d tree over the vectors of a data set, used to assign vectors to centroids with the filtering algorithm
+ * by Kanungo et al.
+ *
+ * Every node keeps the bounding box and the sum of its vectors. While descending, each node receives the candidate
+ * centroids of its parent and drops those that are farther away than some other candidate for every point of the
+ * bounding box. When a single candidate remains, the whole subtree is assigned to it at once, and the sum of the node
+ * is added to the centroid accumulator instead of the individual vectors.
+ *
+ * With distance scaling, a candidate may only be dropped if it's not the current label of any vector in the node,
+ * because the distance to the current label is not scaled. Each node therefore remembers the label shared by all of
+ * its vectors, if there is one. When a whole subtree is assigned at once, the labels of all of its nodes are updated,
+ * so they are correct for the next assignment. The labels must therefore only be changed by the tree itself after it
+ * was built. Leaves test their vectors against the remaining candidates one by one, exactly like
+ * KrazyMeans::findClosestCentroidIndex.
+ */
+struct KdTree {
+  ///@brief A node of the tree. Its vectors are at positions begin up to end in the tree order.
+  struct Node {
+    size_t begin = 0;
+    size_t end = 0;
+    ///@brief Index of the left child, zero for leaves.
+    size_t left = 0;
+    ///@brief Index of the right child, zero for leaves.
+    size_t right = 0;
+  };
+
+  ///@brief The maximum number of vectors in a leaf.
+  size_t leaf_size = 16;
+
+  ///@brief The number of features of every vector.
+  size_t num_features = 0;
+
+  ///@brief The index in the data set of the vectors, in tree order.
+  std::vector<size_t> order;
+
+  ///@brief The features of the vectors, in tree order.
+  std::vector<float> points;
+
+  ///@brief The nodes. The root is node zero.
+  std::vector<Node> nodes;
+
+  ///@brief The bounding box of each node: num_features minima followed by num_features maxima.
+  std::vector<float> bounds;
+
+  ///@brief The sum of the vectors of each node.
+  std::vector<double> sums;
+
+  ///@brief The label shared by all vectors of each node, or -1 when they have different labels.
+  std::vector<long> node_labels;
+
+  /**
+   * @brief Build the tree for a data set. The storage of a previous tree is reused.
+   * @param data_set The data set.
+   */
+  void build(DataSet &data_set);
+
+  ///@brief Forget the labels of the nodes, to assign labels that were not assigned by this tree.
+  void clearLabels();
+
+  /**
+   * @brief Assign every vector to its closest centroid.
+   *
+   * @param centroids   The centroids.
+   * @param factor      The factor by which distances to centroids other than the current label are scaled.
+   * @param labels      The labels of the vectors, which are updated.
+   * @param sums        Output: the sum of the vectors assigned to each centroid.
+   * @param counts      Output: the number of vectors assigned to each centroid.
+   * @return The number of vectors that changed label.
+   */
+  size_t assign(const std::vector<FeatureVec> &centroids,
+                float factor,
+                std::vector<size_t> &labels,
+                std::vector<double> &sums,
+                std::vector<size_t> &counts);
+
+ private:
+  ///@brief Build the subtree for positions begin up to end. Returns the index of its root.
+  size_t buildNode(DataSet &data_set, size_t begin, size_t end, size_t depth);
+
+  ///@brief Assign the vectors of \p node, given the candidates at \p depth. Returns the new label of the node.
+  long filter(size_t node, size_t num_candidates, size_t depth);
+
+  ///@brief Assign all vectors of \p node to centroid \p c.
+  void assignNode(size_t node, size_t c);
+
+  ///@brief Set the label of \p node and all of its descendants, whose vectors now share that label.
+  void markNode(size_t node, long label);
+
+  ///@brief Return whether all of the bounding box of \p node is closer to centroid \p best than to \p c.
+  bool isDominated(size_t node, size_t c, size_t best);
+
+  ///@brief Return the squared distance between \p a and \p b.
+  float squaredDistance(const float *a, const float *b);
+
+  ///@brief The depth of the tree.
+  size_t depth = 0;
+
+  // State during assignment, reused between assignments.
+  std::vector<float> centroid_values;
+  std::vector<uint32_t> candidates;
+  std::vector<float> scratch;
+  size_t num_clusters = 0;
+  float factor = 1.0f;
+  size_t *labels_ = nullptr;
+  double *sums_ = nullptr;
+  size_t *counts_ = nullptr;
+  size_t changed = 0;
+};
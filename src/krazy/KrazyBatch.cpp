@@ -0,0 +1,90 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <omp.h>
+#include <sstream>
+
+#include "KrazyBatch.hpp"
+#include "../utils/ThreadPool.hpp"
+
+void KrazyBatch::readManifest(const std::string &file_name) {
+  std::ifstream file(file_name);
+
+  if (!file.good()) {
+    throw std::runtime_error("Could not open manifest file.");
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream ss(line);
+    BatchJob job;
+    if (!(ss >> job.input_file) || (job.input_file[0] == '#')) {
+      continue;
+    }
+    if (!(ss >> job.output_file)) {
+      auto dot = job.input_file.find_last_of('.');
+      auto slash = job.input_file.find_last_of('/');
+      if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash))) {
+        dot = job.input_file.size();
+      }
+      job.output_file = job.input_file.substr(0, dot) + ".kml";
+    }
+    jobs.push_back(job);
+  }
+}
+
+// Per-thread state that is reused between jobs.
+struct BatchScratch {
+  std::shared_ptr<DataSet> data_set = std::make_shared<DataSet>();
+  std::unique_ptr<KrazyMeans> km;
+};
+
+size_t KrazyBatch::run(size_t num_threads) {
+  ThreadPool pool(num_threads);
+  std::vector<BatchScratch> scratch(pool.size());
+
+  for (auto &job : jobs) {
+    pool.submit([this, &job, &scratch]() {
+      auto &s = scratch[ThreadPool::workerIndex()];
+      // Loading compressed and CSV files is parallelized with OpenMP, keep that to the thread of this job.
+      omp_set_num_threads(1);
+      try {
+        s.data_set->load(job.input_file);
+        if (s.km) {
+          s.km->reset(s.data_set, num_clusters, scale_threshold_iterations, scale_factor);
+        } else {
+          s.km.reset(new KrazyMeans(s.data_set, num_clusters, scale_threshold_iterations, scale_factor));
+        }
+        s.km->seed = seed;
+        s.km->assignment = assignment;
+        s.km->stopping = stopping;
+        s.km->initialize();
+        s.km->run();
+        s.km->dumpLabels(job.output_file);
+        job.iterations = s.km->iteration;
+      } catch (std::exception &e) {
+        job.failed = true;
+        job.error = e.what();
+      }
+    });
+  }
+  pool.wait();
+
+  size_t failed = 0;
+  for (auto &job : jobs) {
+    if (job.failed) failed++;
+  }
+  return failed;
+}
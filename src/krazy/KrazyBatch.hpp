@@ -0,0 +1,83 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "KrazyMeans.hpp"
+
+///@brief A single data set to cluster in batch mode.
+struct BatchJob {
+  ///@brief The data set file.
+  std::string input_file;
+  ///@brief The file to write the labels to.
+  std::string output_file;
+  ///@brief Whether clustering this data set failed.
+  bool failed = false;
+  ///@brief The reason clustering this data set failed.
+  std::string error;
+  ///@brief The number of iterations it took to converge.
+  unsigned int iterations = 0;
+};
+
+/**
+ * @brief Throughput mode for clustering many (small) data sets concurrently.
+ *
+ * Every data set is loaded and clustered by a single thread of a work-stealing thread pool. Each thread keeps its own DataSet
+ * and KrazyMeans context around, which are reset for the next data set, so once they have grown to the size of the
+ * largest data set, the feature values, labels, centroids and k-d tree are not allocated again. Every job still
+ * allocates a few small objects: its task and the file streams to read the data set and write the labels.
+ */
+struct KrazyBatch {
+  ///@brief The jobs to run.
+  std::vector<BatchJob> jobs;
+
+  ///@brief The number of clusters to generate a clustering for.
+  unsigned int num_clusters = 0;
+
+  ///@brief The iteration threshold before starting distance scaling.
+  unsigned int scale_threshold_iterations = 0;
+
+  ///@brief The factor at which to scale the distance per iteration.
+  float scale_factor = 0.01;
+
+  ///@brief The seed for the random selection of the initial centroids of every data set.
+  int seed = 0;
+
+  ///@brief The strategy to assign feature vectors to centroids.
+  KrazyMeans::Assignment assignment = KrazyMeans::Assignment::Auto;
+
+  ///@brief The rules to stop the clustering of every data set with.
+  KrazyMeans::StoppingRules stopping;
+
+  /**
+   * @brief Read jobs from a manifest file.
+   *
+   * Every line of the manifest holds an input file, optionally followed by whitespace and an output file. Without an
+   * output file, the labels are written next to the input file with the extension replaced by .kml. Empty lines and
+   * lines starting with # are skipped.
+   *
+   * @param file_name The manifest file.
+   */
+  void readManifest(const std::string &file_name);
+
+  /**
+   * @brief Cluster all data sets.
+   * @param num_threads The number of threads to use. Zero selects the number of hardware threads.
+   * @return The number of jobs that failed.
+   */
+  size_t run(size_t num_threads = 0);
+};
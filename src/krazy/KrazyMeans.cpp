@@ -12,42 +12,61 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <fstream>
+#include <omp.h>
 #include "KrazyMeans.hpp"
+#include "KdTree.hpp"
 #include "../utils/Timer.hpp"
+#include "../utils/PerfCounters.hpp"
+#include "../utils/Allocations.hpp"
+#include "../utils/CentroidFile.hpp"
+#include "../utils/Csv.hpp"
 
 KrazyMeans::KrazyMeans(const std::shared_ptr<DataSet> &data_set,
                        unsigned int num_clusters,
                        unsigned int scale_threshold_iters,
-                       float scale_factor)
-    : data_set(data_set),
-      num_clusters(num_clusters),
-      scale_factor(scale_factor),
-      scale_threshold_iterations(scale_threshold_iters) {
+                       float scale_factor) {
+  reset(data_set, num_clusters, scale_threshold_iters, scale_factor);
+}
+
+void KrazyMeans::reset(const std::shared_ptr<DataSet> &data_set,
+                       unsigned int num_clusters,
+                       unsigned int scale_threshold_iters,
+                       float scale_factor) {
+  this->data_set = data_set;
+  this->num_clusters = num_clusters;
+  this->scale_factor = scale_factor;
+  this->scale_threshold_iterations = scale_threshold_iters;
+  converged = false;
+  loop_allocations = 0;
+  stop_reason = StopReason::None;
+  changed_labels = 0;
+  centroid_shift = 0.0f;
+  iteration = 0;
+  use_kd_tree = false;
+
   // Initialize all labels to 0
-  labels.reserve(data_set->vectors.size());
-  for (size_t i = 0; i < data_set->vectors.size(); i++) {
-    labels.push_back(0);
-  }
+  labels.assign(data_set->size(), 0);
 
   // Initialize the centroids to be all zero.
-  centroids = std::vector<FeatureVec>(num_clusters, FeatureVec(data_set->num_features, 0.0f));
+  centroids.resize(num_clusters);
+  for (auto &centroid : centroids) {
+    centroid.values.assign(data_set->num_features, 0.0f);
+  }
 }
 
 size_t KrazyMeans::findClosestCentroidIndex(size_t vec_index) {
   float closest = INFINITY;
   size_t index = 0;
 
-  float factor = 1.0f;
-
   // When we reach the iterations threshold, penalize the distance for any vector switching to another centroid
   // This will cause faster convergence
-  if (iteration >= scale_threshold_iterations) {
-    factor = 1.0f + (float) (iteration - scale_threshold_iterations) * scale_factor;
-  }
+  float factor = calculateSwitchPenalty(iteration, scale_threshold_iterations, scale_factor);
 
   for (size_t c = 0; c < centroids.size(); c++) {
-    float dist = calculateEuclideanDistance(data_set->vector(vec_index), centroids[c]);
+    float dist = calculateEuclideanDistance(data_set->vector(vec_index), centroids[c].values.data(),
+                                            data_set->num_features);
 
     // Penalize potential swapping of labels with a factor
     if (labels[vec_index] != c) {
@@ -63,24 +82,59 @@ size_t KrazyMeans::findClosestCentroidIndex(size_t vec_index) {
 }
 
 void KrazyMeans::selectRandomCentroids() {
-  UniformRandomGenerator<long> rg;
+  UniformRandomGenerator<long> rg(seed);
   // For each cluster centroid, randomly select a feature vector as initialization.
   for (auto &vector : centroids) {
-    vector = data_set->vectors[rg.next() % data_set->size()];
+    auto features = data_set->vector(rg.next() % data_set->size());
+    vector.values.assign(features, features + data_set->num_features);
+  }
+}
+
+const char *KrazyMeans::toString(StopReason reason) {
+  switch (reason) {
+    case StopReason::None: return "not stopped";
+    case StopReason::Converged: return "converged";
+    case StopReason::ChangedLabels: return "changed labels fraction";
+    case StopReason::CentroidShift: return "centroid shift";
+    case StopReason::MaxIterations: return "iteration limit";
+    case StopReason::TimeBudget: return "time budget";
   }
+  return "unknown";
 }
 
-bool KrazyMeans::updateLabels() {
-  auto updated = false;
+KrazyMeans::StopReason KrazyMeans::StoppingRules::apply(size_t changed_labels,
+                                                        size_t num_vectors,
+                                                        float centroid_shift,
+                                                        unsigned int iteration) const {
+  if (changed_labels == 0) {
+    return StopReason::Converged;
+  } else if ((double) changed_labels <= max_changed_fraction * (double) num_vectors) {
+    return StopReason::ChangedLabels;
+  } else if (tracksCentroidShift() && (centroid_shift <= max_centroid_shift)) {
+    return StopReason::CentroidShift;
+  } else if ((max_iterations != 0) && (iteration >= max_iterations)) {
+    return StopReason::MaxIterations;
+  }
+  return StopReason::None;
+}
+
+size_t KrazyMeans::updateLabels() {
+  if (use_kd_tree) {
+    float factor = calculateSwitchPenalty(iteration, scale_threshold_iterations, scale_factor);
+    return kd_tree->assign(centroids, factor, labels, sums, counts);
+  }
+
+  size_t changed = 0;
   // For each feature vector, find the current closest centroid
+#pragma omp parallel for num_threads(threads()) reduction(+:changed)
   for (size_t i = 0; i < data_set->size(); i++) {
     auto closest = findClosestCentroidIndex(i);
     if (labels[i] != closest) {
       labels[i] = closest;
-      updated = true;
+      changed++;
     }
   }
-  return updated;
+  return changed;
 }
 
 void KrazyMeans::clearCentroids() {
@@ -90,12 +144,24 @@ void KrazyMeans::clearCentroids() {
 }
 
 void KrazyMeans::updateCentroids() {
+  // The k-d tree has already accumulated the feature vectors of every centroid during the assignment.
+  if (use_kd_tree) {
+    auto F = data_set->num_features;
+    for (size_t c = 0; c < centroids.size(); c++) {
+      for (size_t f = 0; f < F; f++) {
+        centroids[c][f] = counts[c] != 0 ? (float) (sums[c * F + f] / (double) counts[c]) : 0.0f;
+      }
+    }
+    return;
+  }
+
   // Extremely naive implementation to update centroids.
 
   // Clear the centroids
   clearCentroids();
 
   // Iterate over all centroids
+#pragma omp parallel for num_threads(threads())
   for (size_t c = 0; c < centroids.size(); c++) {
     // Keep track of amount of feature vectors assigned to this centroid.
     size_t num_assigned = 0;
@@ -107,7 +173,7 @@ void KrazyMeans::updateCentroids() {
         num_assigned++;
         // Accumulate the centroid feature values
         for (size_t f = 0; f < centroids[c].size(); f++) {
-          centroids[c][f] += data_set->vectors[v][f];
+          centroids[c][f] += data_set->vector(v)[f];
         }
       }
     }
@@ -120,18 +186,95 @@ void KrazyMeans::updateCentroids() {
   }
 }
 
+int KrazyMeans::threads() const {
+  return num_threads != 0 ? (int) num_threads : omp_get_max_threads();
+}
+
+void KrazyMeans::prepareAssignment() {
+  use_kd_tree = (assignment == Assignment::KdTree) ||
+      ((assignment == Assignment::Auto) && (data_set->num_features <= kd_tree_max_features));
+  if (use_kd_tree) {
+    if (!kd_tree) {
+      kd_tree = std::make_shared<KdTree>();
+    }
+    if (keep_kd_tree && (kd_tree_source.lock() == data_set)) {
+      // The labels were reset, so the labels of the nodes no longer hold.
+      kd_tree->clearLabels();
+    } else {
+      kd_tree->build(*data_set);
+      kd_tree_source = data_set;
+    }
+  }
+}
+
+// Check that a data set can be clustered at all.
+static void checkDataSet(const DataSet &data_set) {
+  if ((data_set.size() == 0) || (data_set.num_features == 0)) {
+    throw std::runtime_error("Can't cluster a data set without vectors or features.");
+  }
+}
+
 void KrazyMeans::initialize() {
+  checkDataSet(*data_set);
+  PerfCounters::Reading r;
+  if (profile) r = profile->begin();
+  prepareAssignment();
   selectRandomCentroids();
+  if (profile) r = profile->end("Initialization", r);
   updateLabels();
+  if (profile) profile->end("Assignment", r);
+}
+
+void KrazyMeans::initialize(const std::vector<FeatureVec> &initial_centroids) {
+  checkDataSet(*data_set);
+  if ((initial_centroids.size() != num_clusters) ||
+      (!initial_centroids.empty() && (initial_centroids[0].size() != data_set->num_features))) {
+    throw std::runtime_error("Initial centroids don't match the number of clusters or features.");
+  }
+  PerfCounters::Reading r;
+  if (profile) r = profile->begin();
+  prepareAssignment();
+  centroids = initial_centroids;
+  if (profile) r = profile->end("Initialization", r);
+  updateLabels();
+  if (profile) profile->end("Assignment", r);
 }
 
 void KrazyMeans::iterate() {
+  auto allocations = heapAllocations();
+  auto track_shift = stopping.tracksCentroidShift();
+  if (track_shift) {
+    previous_centroids = centroids;
+  }
+
+  PerfCounters::Reading r;
+  if (profile) r = profile->begin();
   updateCentroids();
-  converged = !updateLabels();
+  if (profile) r = profile->end("Centroid update", r);
+  changed_labels = updateLabels();
+  if (profile) profile->end("Assignment", r);
   iteration++;
+
+  if (track_shift) {
+    centroid_shift = 0.0f;
+    for (size_t c = 0; c < centroids.size(); c++) {
+      centroid_shift = std::max(centroid_shift, calculateEuclideanDistance(centroids[c].values.data(),
+                                                                           previous_centroids[c].values.data(),
+                                                                           data_set->num_features));
+    }
+  }
+
+  stop_reason = stopping.apply(changed_labels, data_set->size(), centroid_shift, iteration);
+  converged = stop_reason != StopReason::None;
+
+  if (iteration > 1) {
+    loop_allocations += heapAllocations() - allocations;
+  }
 }
 
 void KrazyMeans::run(bool quiet) {
+  Timer budget;
+  budget.start();
   while (!converged) {
     // Only quiet mode should be optimized. Non-quiet mode is not required.
     if (quiet) {
@@ -146,19 +289,25 @@ void KrazyMeans::run(bool quiet) {
       t.stop();
       std::cout << iteration << " - " << t.seconds() << " s." << std::endl;
     }
+
+    if (!converged && (stopping.time_budget > 0.0)) {
+      budget.stop();
+      if (budget.seconds() >= stopping.time_budget) {
+        stop_reason = StopReason::TimeBudget;
+        converged = true;
+      }
+    }
   }
 }
 
 void KrazyMeans::printState(std::ostream &labels_out, std::ostream &centroids_out) {
   // Print labels for all vectors
-  for (size_t v = 0; v < data_set->size(); v++) {
-    labels_out << v << ", " << labels[v] << ", " << data_set->vector(v).toString() << std::endl;
-  }
+  writeCsv(labels_out, *data_set, labels.data());
+  labels_out.flush();
 
   // Print centroids
-  for (size_t c = 0; c < num_clusters; c++) {
-    centroids_out << c << ", " << centroids[c].toString() << std::endl;
-  }
+  writeCsv(centroids_out, centroids);
+  centroids_out.flush();
 }
 
 void KrazyMeans::dumpLabels(std::string file_name) {
@@ -169,3 +318,7 @@ void KrazyMeans::dumpLabels(std::string file_name) {
     file.write((char *) &labels[v], sizeof(size_t));
   }
 }
+
+void KrazyMeans::dumpCentroids(std::string file_name) {
+  writeCentroids(file_name, centroids);
+}
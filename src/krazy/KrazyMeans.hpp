@@ -20,6 +20,27 @@
 #include "../utils/DataSet.hpp"
 #include "../utils/RandomGenerator.hpp"
 
+struct KdTree;
+struct PerfProfile;
+
+/**
+ * @brief Calculate the factor by which the distance to a centroid other than the current one is scaled.
+ *
+ * When the iterations threshold is reached, the distance for any vector switching to another centroid is penalized.
+ * The penalty grows linearly with the number of iterations over the threshold.
+ *
+ * @param iteration         The current iteration.
+ * @param threshold         The iteration threshold before starting distance scaling.
+ * @param scale_factor      The factor at which to scale the distance per iteration.
+ * @return The factor to multiply the distance with.
+ */
+inline float calculateSwitchPenalty(unsigned int iteration, unsigned int threshold, float scale_factor) {
+  if (iteration >= threshold) {
+    return 1.0f + (float) (iteration - threshold) * scale_factor;
+  }
+  return 1.0f;
+}
+
 /**
  * @brief KrazyMeans context used for Feature Vector clustering.
  *
@@ -36,8 +57,71 @@
  */
 struct KrazyMeans {
 
+  ///@brief Strategies to assign the feature vectors to centroids.
+  enum class Assignment {
+    ///@brief Use the k-d tree for data sets with at most kd_tree_max_features features.
+    Auto,
+    ///@brief Calculate the distance of every feature vector to every centroid.
+    Naive,
+    ///@brief Use the k-d tree filtering algorithm.
+    KdTree
+  };
+
+  ///@brief The maximum number of features for which Assignment::Auto selects the k-d tree.
+  static const size_t kd_tree_max_features = 8;
+
+  ///@brief The reasons for the algorithm to stop.
+  enum class StopReason {
+    ///@brief The algorithm has not stopped yet.
+    None,
+    ///@brief No labels changed.
+    Converged,
+    ///@brief The fraction of changed labels dropped to StoppingRules::max_changed_fraction.
+    ChangedLabels,
+    ///@brief The centroid shift dropped to StoppingRules::max_centroid_shift.
+    CentroidShift,
+    ///@brief StoppingRules::max_iterations was reached.
+    MaxIterations,
+    ///@brief StoppingRules::time_budget was exceeded.
+    TimeBudget
+  };
+
+  /**
+   * @brief Rules that may stop the algorithm before an iteration changes no labels at all.
+   *
+   * On large data sets, the last iterations often move only a handful of feature vectors. These rules trade a little
+   * accuracy for time. A rule set to zero is disabled, so the defaults only stop on convergence.
+   */
+  struct StoppingRules {
+    ///@brief Stop when at most this fraction of the labels changed in an iteration.
+    double max_changed_fraction = 0.0;
+    ///@brief Stop when no centroid moved further than this distance in an iteration.
+    float max_centroid_shift = 0.0f;
+    ///@brief Stop after this number of iterations.
+    unsigned int max_iterations = 0;
+    ///@brief Stop when run() has been running for this number of seconds.
+    double time_budget = 0.0;
+
+    ///@brief Return whether the centroid shift has to be calculated.
+    bool tracksCentroidShift() const { return max_centroid_shift > 0.0f; }
+
+    /**
+     * @brief Apply all rules except for the time budget to the outcome of an iteration, the strongest rule first.
+     *
+     * @param changed_labels  The number of labels that changed in the iteration.
+     * @param num_vectors     The number of vectors in the data set.
+     * @param centroid_shift  The largest distance a centroid moved in the iteration, if it is tracked.
+     * @param iteration       The number of iterations so far.
+     * @return The reason to stop, or StopReason::None to continue.
+     */
+    StopReason apply(size_t changed_labels, size_t num_vectors, float centroid_shift, unsigned int iteration) const;
+  };
+
+  ///@brief Return a description of \p reason.
+  static const char *toString(StopReason reason);
+
   ///@brief The data set to work on.
-  const std::shared_ptr<DataSet> data_set;
+  std::shared_ptr<DataSet> data_set;
 
   ///@brief The number of clusters to generate a clustering for.
   unsigned int num_clusters = 0;
@@ -54,12 +138,70 @@ struct KrazyMeans {
   ///@brief The current centroids.
   std::vector<FeatureVec> centroids;
 
-  ///@brief Whether the algorithm has converged.
+  ///@brief Whether the algorithm has converged, or was stopped by one of the stopping rules.
   bool converged = false;
 
+  ///@brief The rules to stop the algorithm with.
+  StoppingRules stopping;
+
+  ///@brief The reason the algorithm stopped.
+  StopReason stop_reason = StopReason::None;
+
+  ///@brief The number of labels that changed in the last iteration.
+  size_t changed_labels = 0;
+
+  ///@brief The largest distance a centroid moved in the last iteration. Only tracked with a centroid shift rule.
+  float centroid_shift = 0.0f;
+
+  ///@brief The centroids before the last update, to calculate the centroid shift.
+  std::vector<FeatureVec> previous_centroids;
+
+  /**
+   * @brief The number of heap allocations made by iterate() after the first iteration.
+   *
+   * The first iteration sizes all buffers, after which iterating must not allocate anymore. Counted for the whole
+   * process, so the worker threads are included, but so are any other threads that allocate at the same time. Only
+   * counted when the program counts allocations (see Allocations.hpp).
+   */
+  size_t loop_allocations = 0;
+
   ///@brief The iteration at which the algorithm is operating currently.
   unsigned int iteration = 0;
 
+  ///@brief The seed for the random selection of the initial centroids.
+  int seed = 0;
+
+  ///@brief The strategy to assign feature vectors to centroids.
+  Assignment assignment = Assignment::Auto;
+
+  ///@brief The number of threads for the naive assignment and centroid update. Zero uses all hardware threads.
+  unsigned int num_threads = 1;
+
+  ///@brief Whether the k-d tree is used. Decided when the algorithm is initialized.
+  bool use_kd_tree = false;
+
+  ///@brief The k-d tree over the data set.
+  std::shared_ptr<KdTree> kd_tree;
+
+  /**
+   * @brief Whether to keep the k-d tree of a previous initialization if the data set is the same object.
+   *
+   * Only set this when the data set doesn't change between initializations, like the data sets of a DataSetCache.
+   */
+  bool keep_kd_tree = false;
+
+  ///@brief The data set the k-d tree was built for.
+  std::weak_ptr<DataSet> kd_tree_source;
+
+  ///@brief The sum of the feature vectors assigned to each centroid, accumulated by the k-d tree.
+  std::vector<double> sums;
+
+  ///@brief The number of feature vectors assigned to each centroid, counted by the k-d tree.
+  std::vector<size_t> counts;
+
+  ///@brief If set, the hardware counters of the initialization, assignment and centroid update are collected here.
+  std::shared_ptr<PerfProfile> profile;
+
   /**
    * @brief Construct a new KrazyMeans context.
    *
@@ -71,7 +213,23 @@ struct KrazyMeans {
   KrazyMeans(const std::shared_ptr<DataSet> &data_set,
              unsigned int num_clusters,
              unsigned int scale_threshold_iters,
-             float scale_factor);;
+             float scale_factor);
+
+  /**
+   * @brief Reset this context to cluster another data set.
+   *
+   * The storage for the labels and centroids is reused, so resetting a context to a data set that is not larger than
+   * any of the previous ones does not allocate.
+   *
+   * @param data_set                The data set to work on.
+   * @param num_clusters            The number of clusters to calculate centroids for.
+   * @param scale_threshold_iters   Distance scaling when iterations threshold is reached.
+   * @param scale_factor            Distance scaling factor after iterations threshold is reached.
+   */
+  void reset(const std::shared_ptr<DataSet> &data_set,
+             unsigned int num_clusters,
+             unsigned int scale_threshold_iters,
+             float scale_factor);
 
   /**
    * @brief Find the centroid closest to the feature vector /p vec.
@@ -85,9 +243,9 @@ struct KrazyMeans {
 
   /**
    * @brief Update the labels of the feature vectors in the data set.
-   * @return Whether labels were changed. Useful to check for convergence.
+   * @return The number of labels that changed. Useful to check for convergence.
    */
-  bool updateLabels();
+  size_t updateLabels();
 
   ///@brief Reset the centroid feature values to zero.
   void clearCentroids();
@@ -95,19 +253,34 @@ struct KrazyMeans {
   ///@brief Calculate the new position of the centroids according to the labels.
   void updateCentroids();
 
-  ///@brief Initialize the KMeans clustering algorithm
+  ///@brief Return the number of threads to use.
+  int threads() const;
+
+  /**
+   * @brief Initialize the KMeans clustering algorithm. Builds the k-d tree if it is going to be used.
+   * @throws std::runtime_error if the data set has no vectors or no features.
+   */
   void initialize();
 
-  ///@brief Run a single iteration.
+  ///@brief Initialize the KMeans clustering algorithm, starting from \p initial_centroids instead of random ones.
+  void initialize(const std::vector<FeatureVec> &initial_centroids);
+
+  ///@brief Select the assignment strategy and build the k-d tree if it is going to be used.
+  void prepareAssignment();
+
+  ///@brief Run a single iteration, and apply the stopping rules except for the time budget.
   void iterate();
 
-  /// @brief Run all iterations until convergence.
+  /// @brief Run all iterations until convergence or until one of the stopping rules applies.
   /// Non-quiet mode doesn't have to be implemented by students.
   void run(bool quiet=true);
 
-  ///@brief Print the state of the clustering algorithm. Not recommended for large data sets.
+  ///@brief Print the state of the clustering algorithm as CSV.
   void printState(std::ostream &labels_out = std::cout, std::ostream &centroids_out = std::cout);
 
   ///@brief Dump the labels to a file.
   void dumpLabels(std::string file_name);
+
+  ///@brief Dump the centroids to a binary file, to label other data sets with later.
+  void dumpCentroids(std::string file_name);
 };
\ No newline at end of file
@@ -0,0 +1,317 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#include "KrazyServer.hpp"
+#include "KrazyMeans.hpp"
+#include "../utils/Timer.hpp"
+
+// Maximum length of a request line.
+static const size_t max_line = 4096;
+
+// Time a client gets to send its request line, in milliseconds.
+static const int request_timeout_ms = 5000;
+
+std::string ServerRequest::toString() const {
+  std::stringstream ss;
+  ss.precision(17);
+  ss << "cluster input=" << input_file;
+  if (!output_file.empty()) ss << " output=" << output_file;
+  ss << " k=" << num_clusters << " t=" << scale_threshold_iterations << " s=" << scale_factor << " seed=" << seed
+     << " threads=" << num_threads;
+  if (stopping.max_changed_fraction > 0.0) ss << " changed=" << stopping.max_changed_fraction;
+  if (stopping.max_centroid_shift > 0.0f) ss << " shift=" << stopping.max_centroid_shift;
+  if (stopping.max_iterations != 0) ss << " iters=" << stopping.max_iterations;
+  if (stopping.time_budget > 0.0) ss << " budget=" << stopping.time_budget;
+  return ss.str();
+}
+
+ServerRequest ServerRequest::parse(std::istream &args) {
+  ServerRequest req;
+  std::string arg;
+  while (args >> arg) {
+    auto eq = arg.find('=');
+    if (eq == std::string::npos) {
+      throw std::runtime_error("Expected key=value, got " + arg);
+    }
+    auto key = arg.substr(0, eq);
+    auto value = arg.substr(eq + 1);
+    if (key == "input") req.input_file = value;
+    else if (key == "output") req.output_file = value;
+    else if (key == "k") req.num_clusters = (unsigned int) std::stoul(value);
+    else if (key == "t") req.scale_threshold_iterations = (unsigned int) std::stoul(value);
+    else if (key == "s") req.scale_factor = std::stof(value);
+    else if (key == "seed") req.seed = std::stoi(value);
+    else if (key == "threads") req.num_threads = (unsigned int) std::stoul(value);
+    else if (key == "changed") req.stopping.max_changed_fraction = std::stod(value);
+    else if (key == "shift") req.stopping.max_centroid_shift = std::stof(value);
+    else if (key == "iters") req.stopping.max_iterations = (unsigned int) std::stoul(value);
+    else if (key == "budget") req.stopping.time_budget = std::stod(value);
+    else throw std::runtime_error("Unknown argument " + key);
+  }
+  if (req.input_file.empty()) {
+    throw std::runtime_error("No input file was specified.");
+  }
+  if (req.num_clusters == 0) {
+    throw std::runtime_error("Number of clusters must be positive.");
+  }
+  return req;
+}
+
+KrazyServer::KrazyServer(const std::string &socket_path, size_t cache_bytes, size_t num_threads)
+    : socket_path(socket_path), cache(cache_bytes), pool(num_threads), contexts(pool.size()) {}
+
+// Fill in a socket address for a path.
+static sockaddr_un socketAddress(const std::string &path) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error("Socket path is too long.");
+  }
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  return addr;
+}
+
+// Read a line from a socket, without the newline.
+static std::string readLine(int fd) {
+  std::string line;
+  char c;
+  while ((line.size() < max_line) && (recv(fd, &c, 1, 0) == 1) && (c != '\n')) {
+    line += c;
+  }
+  return line;
+}
+
+// Write all of a string to a socket.
+static void writeAll(int fd, const std::string &str) {
+  size_t written = 0;
+  while (written < str.size()) {
+    auto n = ::send(fd, str.data() + written, str.size() - written, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    written += (size_t) n;
+  }
+}
+
+// Switch a socket between blocking and non-blocking mode.
+static void setBlocking(int fd, bool blocking) {
+  auto flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+}
+
+// A connection of which the request line has not been received completely yet.
+struct PendingConnection {
+  int fd;
+  std::string line;
+  std::chrono::steady_clock::time_point deadline;
+};
+
+void KrazyServer::dispatch(int fd, const std::string &line) {
+  setBlocking(fd, true);
+  std::istringstream ss(line);
+  std::string command;
+  ss >> command;
+  if (command == "cluster") {
+    pool.submit([this, fd, line]() {
+      writeAll(fd, handle(line) + "\n");
+      close(fd);
+    });
+  } else {
+    // Other requests are cheap, answer them right away so they don't wait for clustering jobs.
+    writeAll(fd, handle(line) + "\n");
+    close(fd);
+  }
+}
+
+void KrazyServer::serve() {
+  auto addr = socketAddress(socket_path);
+
+  // Only replace a stale socket, never any other kind of file, nor the socket of a server that is still running. A
+  // socket is stale when connecting to it is refused.
+  struct stat st{};
+  if (lstat(socket_path.c_str(), &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      throw std::runtime_error("Refusing to replace " + socket_path + ", it exists and is not a socket.");
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+      throw std::runtime_error("Could not create socket.");
+    }
+    bool refused = (connect(probe, (sockaddr *) &addr, sizeof(addr)) != 0) && (errno == ECONNREFUSED);
+    close(probe);
+    if (!refused) {
+      throw std::runtime_error("Refusing to replace " + socket_path + ", another server may be listening on it.");
+    }
+    unlink(socket_path.c_str());
+  }
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    throw std::runtime_error("Could not create socket.");
+  }
+  if ((bind(listen_fd, (sockaddr *) &addr, sizeof(addr)) != 0) || (listen(listen_fd, 64) != 0)) {
+    close(listen_fd);
+    throw std::runtime_error("Could not listen on " + socket_path);
+  }
+
+  // Receive the request lines of all connections on this thread, so a client that doesn't send anything can't
+  // occupy a worker. Only clustering jobs go to the thread pool.
+  std::vector<PendingConnection> pending;
+  std::vector<pollfd> fds;
+  char buffer[512];
+  while (!stopping) {
+    fds.assign(1, pollfd{listen_fd, POLLIN, 0});
+    for (auto &p : pending) {
+      fds.push_back(pollfd{p.fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), 100) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::vector<PendingConnection> waiting;
+    for (size_t i = 0; i < pending.size(); i++) {
+      auto &p = pending[i];
+      bool complete = false;
+      if (fds[i + 1].revents != 0) {
+        auto n = recv(p.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+          p.line.append(buffer, (size_t) n);
+        }
+        auto newline = p.line.find('\n');
+        if (newline != std::string::npos) {
+          p.line.resize(newline);
+          complete = true;
+        }
+        // Also handle what was received when the client stops sending or the line is too long.
+        complete = complete || (n == 0) || ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) ||
+            (p.line.size() >= max_line);
+      }
+      if (complete) {
+        dispatch(p.fd, p.line.substr(0, max_line));
+      } else if (now >= p.deadline) {
+        setBlocking(p.fd, true);
+        writeAll(p.fd, "ERROR Timed out waiting for the request.\n");
+        close(p.fd);
+      } else {
+        waiting.push_back(p);
+      }
+    }
+    pending.swap(waiting);
+
+    if (fds[0].revents != 0) {
+      int fd = accept(listen_fd, nullptr, nullptr);
+      if (fd >= 0) {
+        setBlocking(fd, false);
+        pending.push_back(PendingConnection{fd, std::string(), now + std::chrono::milliseconds(request_timeout_ms)});
+      } else if (!stopping && (errno != EINTR) && (errno != EAGAIN) && (errno != ECONNABORTED)) {
+        close(listen_fd);
+        throw std::runtime_error("Could not accept connection.");
+      }
+    }
+  }
+
+  for (auto &p : pending) {
+    close(p.fd);
+  }
+  pool.wait();
+  close(listen_fd);
+  unlink(socket_path.c_str());
+}
+
+std::string KrazyServer::handle(const std::string &line) {
+  std::istringstream ss(line);
+  std::string command;
+  ss >> command;
+
+  try {
+    if (command == "cluster") {
+      auto req = ServerRequest::parse(ss);
+      Timer t;
+      t.start();
+      bool cached = false;
+      auto ds = cache.get(req.input_file, &cached);
+
+      // Reuse the context of the worker. Requests handled elsewhere get a context of their own.
+      std::unique_ptr<KrazyMeans> own;
+      auto worker = ThreadPool::workerIndex();
+      auto &context = (worker >= 0) && ((size_t) worker < contexts.size()) ? contexts[worker] : own;
+      if (context) {
+        context->reset(ds, req.num_clusters, req.scale_threshold_iterations, req.scale_factor);
+      } else {
+        context.reset(new KrazyMeans(ds, req.num_clusters, req.scale_threshold_iterations, req.scale_factor));
+        // Cached data sets don't change, so a worker that clusters the same one again skips building the k-d tree.
+        context->keep_kd_tree = true;
+      }
+      auto &km = *context;
+      km.seed = req.seed;
+      km.num_threads = req.num_threads;
+      km.stopping = req.stopping;
+      km.initialize();
+      km.run();
+      if (!req.output_file.empty()) {
+        km.dumpLabels(req.output_file);
+      }
+      // Don't keep the data set alive after the cache drops it.
+      km.data_set.reset();
+      t.stop();
+
+      std::stringstream response;
+      std::string reason = KrazyMeans::toString(km.stop_reason);
+      std::replace(reason.begin(), reason.end(), ' ', '_');
+      response << "OK iterations=" << km.iteration << " seconds=" << t.seconds() << " cached=" << cached
+               << " stop=" << reason;
+      return response.str();
+    } else if (command == "stats") {
+      std::stringstream response;
+      response << "OK datasets=" << cache.size() << " bytes=" << cache.bytes();
+      return response.str();
+    } else if (command == "shutdown") {
+      // Wake up the accept loop.
+      stopping = true;
+      shutdown(listen_fd, SHUT_RDWR);
+      return "OK";
+    } else {
+      return "ERROR Unknown request: " + command;
+    }
+  } catch (std::exception &e) {
+    return std::string("ERROR ") + e.what();
+  }
+}
+
+std::string KrazyServer::send(const std::string &socket_path, const std::string &request) {
+  auto addr = socketAddress(socket_path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if ((fd < 0) || (connect(fd, (sockaddr *) &addr, sizeof(addr)) != 0)) {
+    if (fd >= 0) close(fd);
+    throw std::runtime_error("Could not connect to " + socket_path);
+  }
+  writeAll(fd, request + "\n");
+  auto response = readLine(fd);
+  close(fd);
+  return response;
+}
@@ -0,0 +1,105 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "KrazyMeans.hpp"
+#include "../utils/DataSetCache.hpp"
+#include "../utils/ThreadPool.hpp"
+
+///@brief A clustering request to the server.
+struct ServerRequest {
+  std::string input_file;
+  std::string output_file;
+  unsigned int num_clusters = 4;
+  unsigned int scale_threshold_iterations = 64;
+  float scale_factor = 1e-5;
+  int seed = 0;
+  unsigned int num_threads = 1;
+  KrazyMeans::StoppingRules stopping;
+
+  ///@brief Format the request as a line of the server protocol.
+  std::string toString() const;
+
+  ///@brief Parse the key=value arguments of a cluster request.
+  static ServerRequest parse(std::istream &args);
+};
+
+/**
+ * @brief A resident server that keeps data sets loaded between clustering jobs.
+ *
+ * The server listens on a Unix domain socket. Every connection carries one request line and receives one response
+ * line, after which the connection is closed. The request lines are received on the thread that runs the server,
+ * which gives up on clients that don't send a complete line within a few seconds. Clustering requests are handled
+ * concurrently on a thread pool, the other requests are answered right away. Every worker keeps its KrazyMeans context
+ * between requests, so the labels, centroids and k-d tree are only allocated again for a larger data set. When a worker
+ * clusters the same cached data set again, it also keeps the k-d tree it built before. This memory is held on to in
+ * addition to the cache. Requests are:
+ *
+ *   cluster input=<file> [output=<file>] [k=K] [t=T] [s=S] [seed=R] [threads=J]
+ *           [changed=Y] [shift=U] [iters=N] [budget=W]
+ *   stats
+ *   shutdown
+ *
+ * The changed, shift, iters and budget arguments are the stopping rules of KrazyMeans, which are off by default. The
+ * response to a cluster request reports the rule that stopped the run, with underscores for spaces.
+ *
+ * Responses start with OK or ERROR. File names can't contain whitespace and should be absolute, since they are
+ * resolved by the server.
+ */
+struct KrazyServer {
+  ///@brief The path of the socket.
+  std::string socket_path;
+
+  /**
+   * @brief Construct a new server.
+   * @param socket_path   The path of the socket to listen on.
+   * @param cache_bytes   The maximum number of bytes of feature values to keep cached.
+   * @param num_threads   The number of requests to handle concurrently. Zero uses all hardware threads.
+   */
+  KrazyServer(const std::string &socket_path, size_t cache_bytes, size_t num_threads = 0);
+
+  /**
+   * @brief Serve requests until a shutdown request arrives. A stale socket at the socket path is replaced, but not
+   * the socket of a running server, nor any other kind of file.
+   */
+  void serve();
+
+  ///@brief Handle a single request line and return the response line.
+  std::string handle(const std::string &line);
+
+  /**
+   * @brief Send a request to a server and wait for the response.
+   * @param socket_path   The socket of the server.
+   * @param request       The request line.
+   * @return The response line.
+   */
+  static std::string send(const std::string &socket_path, const std::string &request);
+
+ private:
+  DataSetCache cache;
+  ThreadPool pool;
+  ///@brief The KrazyMeans context of every worker of the pool, reused between requests.
+  std::vector<std::unique_ptr<KrazyMeans>> contexts;
+  int listen_fd = -1;
+  std::atomic<bool> stopping{false};
+
+  ///@brief Handle the request line received on connection \p fd, and close it when done.
+  void dispatch(int fd, const std::string &line);
+};
@@ -0,0 +1,91 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <omp.h>
+
+#include "Predictor.hpp"
+#include "../utils/DataSetReader.hpp"
+
+Predictor::Predictor(const std::vector<FeatureVec> &centroids)
+    : num_features(centroids.empty() ? 0 : centroids[0].size()),
+      num_clusters(centroids.size()) {
+  for (auto &centroid : centroids) {
+    this->centroids.insert(this->centroids.end(), centroid.values.begin(), centroid.values.end());
+  }
+}
+
+void Predictor::predict(const float *vectors, size_t num_vectors, size_t *labels) const {
+  auto F = num_features;
+  auto K = num_clusters;
+  auto cents = centroids.data();
+  auto threads = num_threads != 0 ? (int) num_threads : omp_get_max_threads();
+
+#pragma omp parallel for schedule(static) num_threads(threads)
+  for (size_t v = 0; v < num_vectors; v++) {
+    auto vec = vectors + v * F;
+    float closest = INFINITY;
+    size_t index = 0;
+    for (size_t c = 0; c < K; c++) {
+      auto cent = cents + c * F;
+      // The squared distance selects the same centroid as the distance itself.
+      float dist = 0.0f;
+#pragma omp simd reduction(+:dist)
+      for (size_t f = 0; f < F; f++) {
+        float d = vec[f] - cent[f];
+        dist += d * d;
+      }
+      if (dist < closest) {
+        closest = dist;
+        index = c;
+      }
+    }
+    labels[v] = index;
+  }
+}
+
+size_t Predictor::predictFile(const std::string &input_file, const std::string &output_file, size_t batch_vectors) {
+  DataSetReader reader(input_file);
+  if (reader.num_features != num_features) {
+    throw std::runtime_error("Data set has a different number of features than the centroids.");
+  }
+
+  std::ofstream out(output_file, std::ios::binary);
+  if (!out.good()) {
+    throw std::runtime_error("Could not write to file.");
+  }
+
+  DataSet batches[2] = {DataSet(num_features), DataSet(num_features)};
+  std::vector<size_t> labels;
+
+  size_t current = 0;
+  auto count = reader.read(batches[current], batch_vectors);
+  while (count > 0) {
+    // Read the next batch while labeling this one.
+    auto next = std::async(std::launch::async, [&reader, &batches, current, batch_vectors]() {
+      return reader.read(batches[1 - current], batch_vectors);
+    });
+
+    labels.resize(count);
+    predict(batches[current].vector(0), count, labels.data());
+    out.write((char *) labels.data(), labels.size() * sizeof(size_t));
+
+    count = next.get();
+    current = 1 - current;
+  }
+
+  return reader.position;
+}
@@ -0,0 +1,64 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../utils/FeatureVec.hpp"
+
+/**
+ * @brief Assigns feature vectors to the closest of a fixed set of centroids.
+ *
+ * This labels new data against a model that was trained before. There is no distance scaling, since the vectors
+ * don't have a previous label.
+ */
+struct Predictor {
+  ///@brief The number of features of every centroid.
+  size_t num_features = 0;
+
+  ///@brief The number of centroids.
+  size_t num_clusters = 0;
+
+  ///@brief The row-major feature values of all centroids.
+  std::vector<float> centroids;
+
+  ///@brief The number of threads to label with. Zero uses all hardware threads.
+  unsigned int num_threads = 0;
+
+  ///@brief Construct a Predictor for \p centroids.
+  explicit Predictor(const std::vector<FeatureVec> &centroids);
+
+  /**
+   * @brief Find the closest centroid for every vector, in parallel.
+   * @param vectors       Row-major features of the vectors.
+   * @param num_vectors   The number of vectors.
+   * @param labels        The labels to write, one per vector.
+   */
+  void predict(const float *vectors, size_t num_vectors, size_t *labels) const;
+
+  /**
+   * @brief Label all vectors of a data set file, streaming it in batches.
+   *
+   * Reading the next batch overlaps with labeling the current one. The labels are written in the same format as
+   * KrazyMeans::dumpLabels.
+   *
+   * @param input_file      The data set to label.
+   * @param output_file     The file to write the labels to.
+   * @param batch_vectors   The number of vectors per batch.
+   * @return The number of labeled vectors.
+   */
+  size_t predictFile(const std::string &input_file, const std::string &output_file, size_t batch_vectors = 1 << 18);
+};
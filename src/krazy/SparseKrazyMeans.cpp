@@ -0,0 +1,211 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <omp.h>
+
+#include "SparseKrazyMeans.hpp"
+#include "KrazyMeans.hpp"
+#include "../utils/RandomGenerator.hpp"
+#include "../utils/Timer.hpp"
+#include "../utils/CentroidFile.hpp"
+
+SparseKrazyMeans::SparseKrazyMeans(const std::shared_ptr<SparseDataSet> &data_set,
+                                   unsigned int num_clusters,
+                                   unsigned int scale_threshold_iters,
+                                   float scale_factor)
+    : data_set(data_set),
+      num_clusters(num_clusters),
+      scale_threshold_iterations(scale_threshold_iters),
+      scale_factor(scale_factor) {
+  labels = std::vector<size_t>(data_set->size(), 0);
+  centroids = std::vector<FeatureVec>(num_clusters, FeatureVec(data_set->num_features, 0.0f));
+  centroid_norms = std::vector<float>(num_clusters, 0.0f);
+
+  // Calculate the squared norm of every vector once.
+  vector_norms.resize(data_set->size());
+  for (size_t v = 0; v < data_set->size(); v++) {
+    float norm = 0.0f;
+    for (auto i = data_set->offsets[v]; i < data_set->offsets[v + 1]; i++) {
+      norm += data_set->values[i] * data_set->values[i];
+    }
+    vector_norms[v] = norm;
+  }
+}
+
+float SparseKrazyMeans::calculateDistance(size_t vec_index, size_t c) {
+  auto &centroid = centroids[c].values;
+  float dot = 0.0f;
+  for (auto i = data_set->offsets[vec_index]; i < data_set->offsets[vec_index + 1]; i++) {
+    dot += data_set->values[i] * centroid[data_set->indices[i]];
+  }
+  // Rounding errors may push the squared distance of nearly identical vectors slightly below zero.
+  auto squared = vector_norms[vec_index] + centroid_norms[c] - 2.0f * dot;
+  return std::sqrt(squared > 0.0f ? squared : 0.0f);
+}
+
+size_t SparseKrazyMeans::findClosestCentroidIndex(size_t vec_index) {
+  float closest = INFINITY;
+  size_t index = 0;
+
+  float factor = calculateSwitchPenalty(iteration, scale_threshold_iterations, scale_factor);
+
+  for (size_t c = 0; c < centroids.size(); c++) {
+    float dist = calculateDistance(vec_index, c);
+
+    // Penalize potential swapping of labels with a factor
+    if (labels[vec_index] != c) {
+      dist = dist * factor;
+    }
+
+    if (dist < closest) {
+      closest = dist;
+      index = c;
+    }
+  }
+  return index;
+}
+
+void SparseKrazyMeans::selectRandomCentroids() {
+  UniformRandomGenerator<long> rg(seed);
+  // For each cluster centroid, randomly select a feature vector as initialization.
+  for (auto &centroid : centroids) {
+    auto v = rg.next() % data_set->size();
+    centroid.clear();
+    for (auto i = data_set->offsets[v]; i < data_set->offsets[v + 1]; i++) {
+      centroid[data_set->indices[i]] = data_set->values[i];
+    }
+  }
+  updateCentroidNorms();
+}
+
+size_t SparseKrazyMeans::updateLabels() {
+  size_t changed = 0;
+  // For each feature vector, find the current closest centroid
+#pragma omp parallel for num_threads(threads()) reduction(+:changed)
+  for (size_t v = 0; v < data_set->size(); v++) {
+    auto closest = findClosestCentroidIndex(v);
+    if (labels[v] != closest) {
+      labels[v] = closest;
+      changed++;
+    }
+  }
+  return changed;
+}
+
+void SparseKrazyMeans::updateCentroids() {
+  num_assigned.assign(num_clusters, 0);
+
+  for (auto &centroid : centroids) {
+    centroid.clear();
+  }
+
+  // Scatter the non-zeros of every vector into the centroid it is assigned to.
+  for (size_t v = 0; v < data_set->size(); v++) {
+    auto &centroid = centroids[labels[v]].values;
+    num_assigned[labels[v]]++;
+    for (auto i = data_set->offsets[v]; i < data_set->offsets[v + 1]; i++) {
+      centroid[data_set->indices[i]] += data_set->values[i];
+    }
+  }
+
+  // Average out each feature if new assignments were made
+  for (size_t c = 0; c < num_clusters; c++) {
+    if (num_assigned[c] != 0) {
+      for (auto &f : centroids[c].values) {
+        f /= (float) num_assigned[c];
+      }
+    }
+  }
+
+  updateCentroidNorms();
+}
+
+void SparseKrazyMeans::updateCentroidNorms() {
+  for (size_t c = 0; c < num_clusters; c++) {
+    float norm = 0.0f;
+    for (auto f : centroids[c].values) {
+      norm += f * f;
+    }
+    centroid_norms[c] = norm;
+  }
+}
+
+void SparseKrazyMeans::initialize() {
+  if ((data_set->size() == 0) || (data_set->num_features == 0)) {
+    throw std::runtime_error("Can't cluster a data set without vectors or features.");
+  }
+  selectRandomCentroids();
+  updateLabels();
+}
+
+int SparseKrazyMeans::threads() const {
+  return num_threads != 0 ? (int) num_threads : omp_get_max_threads();
+}
+
+void SparseKrazyMeans::iterate() {
+  auto track_shift = stopping.tracksCentroidShift();
+  if (track_shift) {
+    previous_centroids = centroids;
+  }
+
+  updateCentroids();
+  changed_labels = updateLabels();
+  iteration++;
+
+  if (track_shift) {
+    centroid_shift = 0.0f;
+    for (size_t c = 0; c < centroids.size(); c++) {
+      centroid_shift = std::max(centroid_shift, calculateEuclideanDistance(centroids[c], previous_centroids[c]));
+    }
+  }
+
+  stop_reason = stopping.apply(changed_labels, data_set->size(), centroid_shift, iteration);
+  converged = stop_reason != KrazyMeans::StopReason::None;
+}
+
+void SparseKrazyMeans::run(bool quiet) {
+  Timer budget;
+  budget.start();
+  while (!converged) {
+    if (quiet) {
+      iterate();
+    } else {
+      Timer t;
+      t.start();
+      iterate();
+      t.stop();
+      std::cout << iteration << " - " << t.seconds() << " s." << std::endl;
+    }
+
+    if (!converged && (stopping.time_budget > 0.0)) {
+      budget.stop();
+      if (budget.seconds() >= stopping.time_budget) {
+        stop_reason = KrazyMeans::StopReason::TimeBudget;
+        converged = true;
+      }
+    }
+  }
+}
+
+void SparseKrazyMeans::dumpLabels(std::string file_name) {
+  std::ofstream file(file_name, std::ios::binary);
+  file.write((char *) labels.data(), labels.size() * sizeof(size_t));
+}
+
+void SparseKrazyMeans::dumpCentroids(std::string file_name) {
+  writeCentroids(file_name, centroids);
+}
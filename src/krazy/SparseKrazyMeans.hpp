@@ -0,0 +1,149 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../utils/SparseDataSet.hpp"
+#include "../utils/FeatureVec.hpp"
+#include "KrazyMeans.hpp"
+
+/**
+ * @brief KrazyMeans context for clustering sparse feature vectors.
+ *
+ * This is the same algorithm as KrazyMeans, including the distance scaling after the iterations threshold, but for
+ * a SparseDataSet. The centroids are dense. Distances are calculated as |x - c|^2 = |x|^2 + |c|^2 - 2 x.c, so only the
+ * non-zeros of a vector have to be visited, using the squared norms of the vectors and centroids that are calculated
+ * in advance.
+ */
+struct SparseKrazyMeans {
+
+  ///@brief The data set to work on.
+  std::shared_ptr<SparseDataSet> data_set;
+
+  ///@brief The number of clusters to generate a clustering for.
+  unsigned int num_clusters = 0;
+
+  ///@brief The iteration threshold before starting distance scaling.
+  unsigned int scale_threshold_iterations = 0;
+
+  ///@brief The factor at which to scale the distance per iteration.
+  float scale_factor = 0.01;
+
+  ///@brief The labels of the feature vectors.
+  std::vector<size_t> labels;
+
+  ///@brief The current centroids.
+  std::vector<FeatureVec> centroids;
+
+  ///@brief The squared norms of the current centroids.
+  std::vector<float> centroid_norms;
+
+  ///@brief The squared norms of the feature vectors.
+  std::vector<float> vector_norms;
+
+  ///@brief Whether the algorithm has converged, or was stopped by one of the stopping rules.
+  bool converged = false;
+
+  ///@brief The iteration at which the algorithm is operating currently.
+  unsigned int iteration = 0;
+
+  ///@brief The seed for the random selection of the initial centroids.
+  int seed = 0;
+
+  ///@brief The number of threads for the assignment. Zero uses all hardware threads.
+  unsigned int num_threads = 1;
+
+  ///@brief The rules to stop the algorithm with, as for KrazyMeans.
+  KrazyMeans::StoppingRules stopping;
+
+  ///@brief The reason the algorithm stopped.
+  KrazyMeans::StopReason stop_reason = KrazyMeans::StopReason::None;
+
+  ///@brief The number of labels that changed in the last iteration.
+  size_t changed_labels = 0;
+
+  ///@brief The largest distance a centroid moved in the last iteration. Only tracked with a centroid shift rule.
+  float centroid_shift = 0.0f;
+
+  ///@brief The centroids before the last update, to calculate the centroid shift.
+  std::vector<FeatureVec> previous_centroids;
+
+  ///@brief The number of vectors assigned to each centroid, reused between iterations.
+  std::vector<size_t> num_assigned;
+
+  /**
+   * @brief Construct a new SparseKrazyMeans context.
+   *
+   * @param data_set                The data set to work on.
+   * @param num_clusters            The number of clusters to calculate centroids for.
+   * @param scale_threshold_iters   Distance scaling when iterations threshold is reached.
+   * @param scale_factor            Distance scaling factor after iterations threshold is reached.
+   */
+  SparseKrazyMeans(const std::shared_ptr<SparseDataSet> &data_set,
+                   unsigned int num_clusters,
+                   unsigned int scale_threshold_iters,
+                   float scale_factor);
+
+  /**
+   * @brief Calculate the Euclidean distance between a sparse feature vector and a centroid.
+   * @param vec_index   The index of the feature vector.
+   * @param c           The index of the centroid.
+   * @return The Euclidean distance.
+   */
+  float calculateDistance(size_t vec_index, size_t c);
+
+  /**
+   * @brief Find the centroid closest to the feature vector at \p vec_index.
+   * @param vec_index The index of a feature vector.
+   * @return The index of the closest centroid.
+   */
+  size_t findClosestCentroidIndex(size_t vec_index);
+
+  ///@brief Select the centroids to be random points in the data set.
+  void selectRandomCentroids();
+
+  /**
+   * @brief Update the labels of the feature vectors in the data set.
+   * @return The number of labels that changed. Useful to check for convergence.
+   */
+  size_t updateLabels();
+
+  ///@brief Calculate the new position and norm of the centroids according to the labels.
+  void updateCentroids();
+
+  ///@brief Calculate the squared norms of the centroids.
+  void updateCentroidNorms();
+
+  ///@brief Initialize the clustering algorithm. Throws std::runtime_error if the data set is empty.
+  void initialize();
+
+  ///@brief Return the number of threads to use.
+  int threads() const;
+
+  ///@brief Run a single iteration, and apply the stopping rules except for the time budget.
+  void iterate();
+
+  /// @brief Run all iterations until convergence or until one of the stopping rules applies.
+  void run(bool quiet=true);
+
+  ///@brief Dump the labels to a file.
+  void dumpLabels(std::string file_name);
+
+  ///@brief Dump the centroids to a binary file, to label other data sets with later.
+  void dumpCentroids(std::string file_name);
+};
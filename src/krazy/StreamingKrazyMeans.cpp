@@ -0,0 +1,164 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <fstream>
+
+#include "StreamingKrazyMeans.hpp"
+#include "KrazyMeans.hpp"
+#include "../utils/RandomGenerator.hpp"
+#include "../utils/Timer.hpp"
+#include "../utils/CentroidFile.hpp"
+
+StreamingKrazyMeans::StreamingKrazyMeans(size_t num_features,
+                                         unsigned int num_clusters,
+                                         unsigned int scale_threshold_iters,
+                                         float scale_factor,
+                                         unsigned int passes)
+    : num_features(num_features),
+      num_clusters(num_clusters),
+      scale_threshold_iterations(scale_threshold_iters),
+      scale_factor(scale_factor),
+      passes(passes),
+      pending(num_features) {
+  centroids = std::vector<FeatureVec>(num_clusters, FeatureVec(num_features, 0.0f));
+  counts = std::vector<size_t>(num_clusters, 0);
+}
+
+size_t StreamingKrazyMeans::findClosestCentroidIndex(const float *vec, size_t label) {
+  float closest = INFINITY;
+  size_t index = 0;
+
+  float factor = calculateSwitchPenalty(iteration, scale_threshold_iterations, scale_factor);
+
+  for (size_t c = 0; c < centroids.size(); c++) {
+    float dist = calculateEuclideanDistance(vec, centroids[c].values.data(), num_features);
+
+    // Penalize potential swapping of labels with a factor, unless the vector doesn't have a label yet.
+    if ((label != num_clusters) && (label != c)) {
+      dist = dist * factor;
+    }
+
+    if (dist < closest) {
+      closest = dist;
+      index = c;
+    }
+  }
+  return index;
+}
+
+void StreamingKrazyMeans::selectRandomCentroids() {
+  UniformRandomGenerator<long> rg;
+  for (auto &centroid : centroids) {
+    auto features = pending.vector(rg.next() % pending.size());
+    centroid.values.assign(features, features + num_features);
+  }
+}
+
+void StreamingKrazyMeans::ingest(const float *vectors, size_t num_vectors) {
+  Timer t;
+  t.start();
+
+  if (!labels.empty()) {
+    process(vectors, num_vectors);
+  } else {
+    // Buffer vectors until there are enough to select the initial centroids from.
+    pending.append(vectors, num_vectors);
+    if (pending.size() >= num_clusters) {
+      selectRandomCentroids();
+      process(pending.vector(0), pending.size());
+      pending.clear();
+    }
+  }
+
+  t.stop();
+  batch_latencies.push_back(t.seconds());
+}
+
+void StreamingKrazyMeans::ingest(DataSet &batch) {
+  if (!batch.isContiguous()) {
+    throw std::runtime_error("Streaming batches must be contiguous.");
+  }
+  ingest(batch.vector(0), batch.size());
+}
+
+void StreamingKrazyMeans::process(const float *vectors, size_t num_vectors) {
+  // Assign the new vectors without penalty, they don't have a label yet.
+  batch_labels.resize(num_vectors);
+  for (size_t v = 0; v < num_vectors; v++) {
+    batch_labels[v] = findClosestCentroidIndex(vectors + v * num_features, num_clusters);
+  }
+
+  if (passes > 1) {
+    batch_counts = counts;
+    batch_centroids = centroids;
+  }
+
+  for (unsigned int p = 0; p < passes; p++) {
+    // Every pass absorbs the vectors of the batch anew, so every vector is absorbed once.
+    if (p > 0) {
+      counts = batch_counts;
+      centroids = batch_centroids;
+    }
+
+    // Move every centroid towards the vectors assigned to it.
+    for (size_t v = 0; v < num_vectors; v++) {
+      auto c = batch_labels[v];
+      auto &centroid = centroids[c].values;
+      auto vec = vectors + v * num_features;
+      counts[c]++;
+      float rate = 1.0f / (float) counts[c];
+      for (size_t f = 0; f < num_features; f++) {
+        centroid[f] += rate * (vec[f] - centroid[f]);
+      }
+    }
+
+    iteration++;
+
+    // Assign the vectors again, now penalizing switches after the threshold.
+    for (size_t v = 0; v < num_vectors; v++) {
+      batch_labels[v] = findClosestCentroidIndex(vectors + v * num_features, batch_labels[v]);
+    }
+  }
+
+  labels.insert(labels.end(), batch_labels.begin(), batch_labels.end());
+}
+
+double StreamingKrazyMeans::latencyPercentile(double p) const {
+  if (batch_latencies.empty()) return 0.0;
+  auto sorted = batch_latencies;
+  std::sort(sorted.begin(), sorted.end());
+  auto index = (size_t) (p / 100.0 * (double) (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void StreamingKrazyMeans::reportLatency(std::ostream &os) const {
+  double total = 0.0;
+  for (auto l : batch_latencies) total += l;
+  os << "Batches                   : " << batch_latencies.size() << std::endl;
+  os << "Mean batch latency        : " << (batch_latencies.empty() ? 0.0 : total / batch_latencies.size()) << " s."
+     << std::endl;
+  os << "Median batch latency      : " << latencyPercentile(50.0) << " s." << std::endl;
+  os << "99th pct. batch latency   : " << latencyPercentile(99.0) << " s." << std::endl;
+  os << "Max. batch latency        : " << latencyPercentile(100.0) << " s." << std::endl;
+}
+
+void StreamingKrazyMeans::dumpLabels(std::string file_name) {
+  std::ofstream file(file_name, std::ios::binary);
+  file.write((char *) labels.data(), labels.size() * sizeof(size_t));
+}
+
+void StreamingKrazyMeans::dumpCentroids(std::string file_name) {
+  writeCentroids(file_name, centroids);
+}
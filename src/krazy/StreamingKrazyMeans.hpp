@@ -0,0 +1,130 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../utils/DataSet.hpp"
+#include "../utils/FeatureVec.hpp"
+
+/**
+ * @brief KrazyMeans context for continuously arriving feature vectors.
+ *
+ * Vectors are ingested in batches. The vectors of a batch are first assigned to their closest centroid. Then, for a
+ * number of passes, the centroids are moved towards the vectors assigned to them with a per-centroid learning rate of
+ * one over the number of vectors the centroid has absorbed so far (mini-batch K-means), after which the vectors of
+ * the batch are assigned again. Every pass starts again from the centroids and counts from before the batch, so every
+ * vector is absorbed once, by the centroid it is assigned to in the last pass. Further passes only refine the
+ * assignment of the batch. Every pass is one iteration; after the iterations threshold, vectors switching to another
+ * centroid have their distance scaled exactly like in KrazyMeans.
+ *
+ * The first batches are buffered until at least num_clusters vectors have arrived, from which the initial centroids
+ * are selected randomly.
+ */
+struct StreamingKrazyMeans {
+  ///@brief The number of features of every vector.
+  size_t num_features = 0;
+
+  ///@brief The number of clusters to generate a clustering for.
+  unsigned int num_clusters = 0;
+
+  ///@brief The iteration threshold before starting distance scaling.
+  unsigned int scale_threshold_iterations = 0;
+
+  ///@brief The factor at which to scale the distance per iteration.
+  float scale_factor = 0.01;
+
+  ///@brief The number of centroid update passes over each batch.
+  unsigned int passes = 1;
+
+  ///@brief The labels of all feature vectors ingested so far, in order of arrival.
+  std::vector<size_t> labels;
+
+  ///@brief The current centroids.
+  std::vector<FeatureVec> centroids;
+
+  ///@brief The number of vectors absorbed by each centroid.
+  std::vector<size_t> counts;
+
+  ///@brief The iteration at which the algorithm is operating currently.
+  unsigned int iteration = 0;
+
+  ///@brief The time it took to ingest every batch, in seconds.
+  std::vector<double> batch_latencies;
+
+  /**
+   * @brief Construct a new streaming KrazyMeans context.
+   *
+   * @param num_features            The number of features of every vector.
+   * @param num_clusters            The number of clusters to calculate centroids for.
+   * @param scale_threshold_iters   Distance scaling when iterations threshold is reached.
+   * @param scale_factor            Distance scaling factor after iterations threshold is reached.
+   * @param passes                  The number of centroid update passes over each batch.
+   */
+  StreamingKrazyMeans(size_t num_features,
+                      unsigned int num_clusters,
+                      unsigned int scale_threshold_iters,
+                      float scale_factor,
+                      unsigned int passes = 1);
+
+  /**
+   * @brief Ingest a batch of feature vectors.
+   * @param vectors       Row-major features of the vectors.
+   * @param num_vectors   The number of vectors in the batch.
+   */
+  void ingest(const float *vectors, size_t num_vectors);
+
+  ///@brief Ingest a batch of feature vectors. The vectors of the batch must be contiguous.
+  void ingest(DataSet &batch);
+
+  ///@brief Return whether the centroids have been initialized.
+  inline bool initialized() const { return !labels.empty(); }
+
+  ///@brief Return the latency of the \p p-th percentile batch, in seconds.
+  double latencyPercentile(double p) const;
+
+  ///@brief Print the batch latency statistics.
+  void reportLatency(std::ostream &os = std::cout) const;
+
+  ///@brief Dump the labels to a file.
+  void dumpLabels(std::string file_name);
+
+  ///@brief Dump the centroids to a binary file.
+  void dumpCentroids(std::string file_name);
+
+ private:
+  ///@brief Vectors waiting for the centroids to be initialized.
+  DataSet pending;
+
+  ///@brief The labels of the batch being ingested.
+  std::vector<size_t> batch_labels;
+
+  ///@brief The number of vectors absorbed by each centroid before the batch being ingested.
+  std::vector<size_t> batch_counts;
+
+  ///@brief The centroids before the batch being ingested.
+  std::vector<FeatureVec> batch_centroids;
+
+  ///@brief Select the initial centroids from the pending vectors.
+  void selectRandomCentroids();
+
+  ///@brief Process a batch once the centroids are initialized.
+  void process(const float *vectors, size_t num_vectors);
+
+  ///@brief Find the centroid closest to \p vec, given its current \p label. Pass num_clusters for no label.
+  size_t findClosestCentroidIndex(const float *vec, size_t label);
+};
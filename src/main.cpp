@@ -12,34 +12,74 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cassert>
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <getopt.h>
+#include <unistd.h>
 
 #include "utils/Timer.hpp"
 #include "utils/DataSet.hpp"
+#include "utils/SparseDataSet.hpp"
+#include "utils/DataSetReader.hpp"
+#include "utils/CentroidFile.hpp"
+#include "utils/Csv.hpp"
+#include "utils/PerfCounters.hpp"
+#include "utils/Allocations.hpp"
 #include "krazy/KrazyMeans.hpp"
+#include "krazy/KrazyBatch.hpp"
+#include "krazy/SparseKrazyMeans.hpp"
+#include "krazy/StreamingKrazyMeans.hpp"
+#include "krazy/Predictor.hpp"
+#include "krazy/KrazyServer.hpp"
+#include "krazy/CoarseToFine.hpp"
 
 ///@brief Program options
 struct ProgramOptions {
   std::string input_file;
   std::string output_file;
+  std::string compressed_file;
+  std::string csv_file;
+  std::string manifest_file;
+  std::string centroids_file;
+  std::string predict_file;
+  std::string server_socket;
+  std::string client_socket;
+  std::string shutdown_socket;
 
   bool generate_example = false;
   bool generate_benchmark = false;
+  float sparse_density = 0.0f;
   bool plot_outputs = false;
+  bool hardware_counters = false;
 
   unsigned int clusters = 4;
   float scaling_factor = 1e-5;
   unsigned int threshold_iters = 64;
+  int seed = 0;
 
   unsigned long features = 2;
   unsigned long vectors = 1024;
 
+  unsigned int threads = 0;
+  bool threads_given = false;
+
+  unsigned long cache_mib = 1024;
+
+  KrazyMeans::Assignment assignment = KrazyMeans::Assignment::Auto;
+
+  KrazyMeans::StoppingRules stopping;
+
+  unsigned long stream_batch = 0;
+
+  std::vector<double> sample_fractions;
+  bool compare_cold_start = false;
+
   /// @brief Print usage information
   static void usage(char *argv[]) {
-    std::cerr << "Usage: " << argv[0] << " -h -i <input> -o <output> -k K -t T -s S -pbe -f F -v V\n"
+    std::cerr << "Usage: " << argv[0] << " -h -i <input> -o <output> -z <compressed> -x <csv> -m <manifest> -j J -l B -c <centroids> -P <centroids> -D <socket> -M M -C <socket> -q <socket> -k K -t T -s S -R R -a A -y Y -u U -n N -w W -g G -G -pbeH -r D -f F -v V\n"
               << "\n"
               << "Example using all commands:\n"
               << argv[0] << "-e -b -p -k 10 -t 8 -s 0.1 -f 2 -v 1024 -i example.kmd -o labels.kml\n"
@@ -49,17 +89,51 @@ struct ProgramOptions {
                  "  -h            Show help and exit.\n"
                  "  -i <input>    Read data set from input file <input>.\n"
                  "  -o <output>   Write labels to output file <output>.\n"
+                 "  -i and -m also accept CSV files with one vector per line (*.csv), except with -l and -P.\n"
+                 "  -z <file>     Write the input data set in compressed format to <file>.\n"
+                 "  -x <file>     Write the input data set as CSV to <file>.\n"
+                 "  -m <manifest> Cluster all data sets listed in <manifest>, one per line, each\n"
+                 "                optionally followed by its output file (default: <input>.kml).\n"
+                 "  -j J          Number of threads, 0 for all hardware threads. Clustering a single data set\n"
+                 "                uses one thread by default, -m, -P and -D use all hardware threads.\n"
+                 "  -l B          Streaming mode: feed the input to the clustering in batches of B vectors.\n"
+                 "  -c <file>     Write the centroids to binary file <file>.\n"
+                 "  -P <file>     Label the input with the centroids in binary file <file>, without clustering.\n"
+                 "\n"
+                 "Server mode:\n"
+                 "  -D <socket>   Run as a server on Unix domain socket <socket>, keeping data sets loaded.\n"
+                 "  -M M          Maximum size of the data set cache of the server in MiB (default: 1024).\n"
+                 "  -C <socket>   Send a clustering request for the input to the server at <socket>.\n"
+                 "                Without -i, request the cache statistics.\n"
+                 "  -q <socket>   Ask the server at <socket> to shut down.\n"
                  "\n"
                  "KrazyMeans algorithm:\n"
                  "  -k K          Number of centroids.\n"
                  "  -t T          Threshold iterations.\n"
                  "  -s S          Distance scaling factor after threshold.\n"
+                 "  -R R          Seed for the selection of the initial centroids.\n"
+                 "  -a A          Assignment strategy: auto (default), naive or kdtree. Auto uses the\n"
+                 "                k-d tree for data sets with at most 8 features.\n"
+                 "  -y Y          Stop when at most a fraction Y of the labels changed in an iteration.\n"
+                 "  -u U          Stop when no centroid moved further than U in an iteration.\n"
+                 "  -n N          Stop after at most N iterations.\n"
+                 "  -w W          Stop after W seconds of clustering.\n"
+                 "                Without these rules, the algorithm runs until no labels change. The rules\n"
+                 "                apply to dense and sparse data sets, to every data set of -m on its own,\n"
+                 "                and are sent along with -C. With -g, -y and -u apply to every stage, while\n"
+                 "                -n and -w bound all stages together. They do not apply to -l, -P and -D.\n"
+                 "  -g G          Coarse-to-fine: converge on random samples of the data set first. G is a\n"
+                 "                comma-separated list of increasing sample fractions, e.g. 0.01,0.1.\n"
+                 "  -G            With -g, also run from a cold start and report the savings.\n"
                  "\n"
                  "Benchmarking and testing:\n"
                  "  -p            Save result in CSV files for Python plotting.\n"
                  "  -b            Generate the benchmark data set (benchmark.kmd).\n"
+                 "  -H            Collect hardware performance counters per phase of the algorithm.\n"
                  "\n"
                  "  -e            Generate an example data set for debugging purposes (example.kmd).\n"
+                 "  -r D          Generate a sparse example data set (sparse.kms) with a fraction D\n"
+                 "                of non-zero features.\n"
                  "  -f F          Number of features for example data set.\n"
                  "  -v V          Number of vectors for example data set.\n";
 
@@ -67,6 +141,17 @@ struct ProgramOptions {
     exit(0);
   }
 
+  ///@brief Return the number of threads to cluster a single data set with. One, unless -j was given.
+  unsigned int clusteringThreads() const {
+    return threads_given ? threads : 1;
+  }
+
+  ///@brief Return whether any of the stopping rules was given.
+  bool hasStoppingRules() const {
+    return (stopping.max_changed_fraction > 0.0) || stopping.tracksCentroidShift() || (stopping.max_iterations != 0) ||
+        (stopping.time_budget > 0.0);
+  }
+
   ///@brief Generate a DataSet useful for Benchmarking
   void generateBenchmark() {
     auto ds = DataSet::random(42, 1024 * 1024);
@@ -79,56 +164,328 @@ struct ProgramOptions {
     ds->toFile("example.kmd");
   }
 
+  ///@brief Generate a sparse DataSet useful for debugging/testing
+  void generateSparseExample() {
+    auto ds = SparseDataSet::random(features, vectors, sparse_density, clusters);
+    ds->toFile("sparse.kms");
+  }
+
+  ///@brief Cluster a sparse data set.
+  void runSparse() {
+    Timer t;
+
+    if ((assignment != KrazyMeans::Assignment::Auto) || plot_outputs || hardware_counters ||
+        !sample_fractions.empty() || !compressed_file.empty() || !csv_file.empty() || !predict_file.empty() ||
+        (stream_batch > 0)) {
+      throw std::runtime_error("Options -a, -p, -H, -g, -z, -x, -P and -l do not apply to sparse data sets.");
+    }
+
+    // Load data
+    t.start();
+    auto ds = SparseDataSet::fromFile(input_file);
+    t.stop();
+    std::cout << "Loading sparse dataset    : " << t.seconds() << " s." << std::endl;
+
+    // Create KM context
+    t.start();
+    auto km = SparseKrazyMeans(ds, clusters, threshold_iters, scaling_factor);
+    km.seed = seed;
+    km.num_threads = clusteringThreads();
+    km.stopping = stopping;
+    km.initialize();
+    t.stop();
+    std::cout << "Algorithm initialization  : " << t.seconds() << " s." << std::endl;
+
+    // Run algorithm
+    t.start();
+    km.run(false);
+    t.stop();
+    std::cout << "Reached convergence after : " << t.seconds() << " s." << std::endl;
+    std::cout << "Iterations                : " << km.iteration << std::endl;
+    std::cout << "Stopped by                : " << KrazyMeans::toString(km.stop_reason) << std::endl;
+
+    // Write labels to file
+    if (!output_file.empty()) {
+      t.start();
+      km.dumpLabels(output_file);
+      t.stop();
+      std::cout << "Writing result            : " << t.seconds() << " s." << std::endl;
+    } else {
+      std::cerr << "No output file was specified." << std::endl;
+    }
+
+    // Write centroids to file
+    if (!centroids_file.empty()) {
+      km.dumpCentroids(centroids_file);
+    }
+  }
+
+  ///@brief Cluster the input file as a stream of batches.
+  void runStreaming() {
+    if (hasStoppingRules()) {
+      throw std::runtime_error("Options -y, -u, -n and -w do not apply to streaming mode.");
+    }
+
+    Timer t;
+    DataSetReader reader(input_file);
+    DataSet batch(reader.num_features);
+    StreamingKrazyMeans km(reader.num_features, clusters, threshold_iters, scaling_factor);
+
+    t.start();
+    while (reader.read(batch, stream_batch) > 0) {
+      km.ingest(batch);
+    }
+    t.stop();
+    std::cout << "Streamed vectors          : " << km.labels.size() << std::endl;
+    std::cout << "Streaming time            : " << t.seconds() << " s." << std::endl;
+    std::cout << "Iterations                : " << km.iteration << std::endl;
+    km.reportLatency();
+
+    if (!output_file.empty()) {
+      km.dumpLabels(output_file);
+    } else {
+      std::cerr << "No output file was specified." << std::endl;
+    }
+    if (!centroids_file.empty()) {
+      km.dumpCentroids(centroids_file);
+    }
+  }
+
+  ///@brief Label the input file with previously saved centroids.
+  void runPredict() {
+    if (hasStoppingRules()) {
+      throw std::runtime_error("Options -y, -u, -n and -w do not apply to labeling with -P.");
+    }
+    if (output_file.empty()) {
+      throw std::runtime_error("No output file was specified.");
+    }
+
+    Timer t;
+    Predictor predictor(readCentroids(predict_file));
+    predictor.num_threads = threads;
+
+    t.start();
+    auto num_vectors = predictor.predictFile(input_file, output_file);
+    t.stop();
+    std::cout << "Labeled vectors           : " << num_vectors << std::endl;
+    std::cout << "Labeling time             : " << t.seconds() << " s." << std::endl;
+    std::cout << "Vectors per second        : " << (double) num_vectors / t.seconds() << std::endl;
+  }
+
+  ///@brief Make a file name absolute, since the server may run in another working directory.
+  static std::string absolutePath(const std::string &file_name) {
+    if (file_name.empty() || (file_name[0] == '/')) return file_name;
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) return file_name;
+    return std::string(cwd) + "/" + file_name;
+  }
+
+  ///@brief Run as a server.
+  void runServer() {
+    if (hasStoppingRules()) {
+      throw std::runtime_error("Options -y, -u, -n and -w do not apply to the server, pass them with -C instead.");
+    }
+    KrazyServer server(server_socket, cache_mib << 20, threads);
+    std::cout << "Serving on " << server_socket << std::endl;
+    server.serve();
+  }
+
+  ///@brief Send a request to a server.
+  void runClient() {
+    std::string request = "stats";
+    if (!input_file.empty()) {
+      ServerRequest req;
+      req.input_file = absolutePath(input_file);
+      req.output_file = absolutePath(output_file);
+      req.num_clusters = clusters;
+      req.scale_threshold_iterations = threshold_iters;
+      req.scale_factor = scaling_factor;
+      req.seed = seed;
+      req.num_threads = clusteringThreads();
+      req.stopping = stopping;
+      request = req.toString();
+    }
+    std::cout << KrazyServer::send(client_socket, request) << std::endl;
+  }
+
+  ///@brief Cluster all data sets in the manifest.
+  void runBatch() {
+    Timer t;
+    KrazyBatch batch;
+    batch.num_clusters = clusters;
+    batch.scale_threshold_iterations = threshold_iters;
+    batch.scale_factor = scaling_factor;
+    batch.seed = seed;
+    batch.assignment = assignment;
+    batch.stopping = stopping;
+    batch.readManifest(manifest_file);
+
+    t.start();
+    auto failed = batch.run(threads);
+    t.stop();
+
+    for (auto &job : batch.jobs) {
+      if (job.failed) {
+        std::cerr << "Could not cluster " << job.input_file << ": " << job.error << std::endl;
+      }
+    }
+    std::cout << "Clustered data sets       : " << batch.jobs.size() - failed << std::endl;
+    std::cout << "Failed data sets          : " << failed << std::endl;
+    std::cout << "Batch run time            : " << t.seconds() << " s." << std::endl;
+    std::cout << "Data sets per second      : " << (double) batch.jobs.size() / t.seconds() << std::endl;
+  }
+
   ///@brief Run whatever was specified.
   void run() {
     if (generate_benchmark) generateBenchmark();
     if (generate_example) generateExample();
-
-    if (!input_file.empty()) {
+    if (sparse_density > 0.0f) generateSparseExample();
+
+    if (!server_socket.empty()) {
+      runServer();
+    } else if (!shutdown_socket.empty()) {
+      std::cout << KrazyServer::send(shutdown_socket, "shutdown") << std::endl;
+    } else if (!client_socket.empty()) {
+      runClient();
+    } else if (!manifest_file.empty()) {
+      runBatch();
+    } else if (!input_file.empty() && SparseDataSet::isSparseFile(input_file)) {
+      runSparse();
+    } else if (!input_file.empty() && !predict_file.empty()) {
+      runPredict();
+    } else if (!input_file.empty() && (stream_batch > 0)) {
+      runStreaming();
+    } else if (!input_file.empty()) {
       Timer t;
 
+      // Open the hardware counters before any threads are started, so that they are counted as well
+      std::shared_ptr<PerfProfile> profile;
+      PerfCounters::Reading r;
+      if (hardware_counters) {
+        profile = std::make_shared<PerfProfile>();
+      }
+
       // Load data
       t.start();
+      if (profile) r = profile->begin();
       auto ds = DataSet::fromFile(input_file);
+      if (profile) profile->end("Loading", r);
       t.stop();
       std::cout << "Loading dataset           : " << t.seconds() << " s." << std::endl;
 
+      // Write compressed data set
+      if (!compressed_file.empty()) {
+        t.start();
+        if (profile) r = profile->begin();
+        ds->toCompressedFile(compressed_file);
+        if (profile) profile->end("Writing", r);
+        t.stop();
+        std::cout << "Writing compressed dataset: " << t.seconds() << " s." << std::endl;
+      }
+
+      // Write CSV data set
+      if (!csv_file.empty()) {
+        t.start();
+        if (profile) r = profile->begin();
+        std::ofstream csv_out(csv_file);
+        writeCsv(csv_out, *ds);
+        csv_out.flush();
+        if (profile) profile->end("Writing", r);
+        t.stop();
+        std::cout << "Writing CSV dataset       : " << t.seconds() << " s." << std::endl;
+      }
+
       // Create KM context
       auto km = KrazyMeans(ds, clusters, threshold_iters, scaling_factor);
+      km.assignment = assignment;
+      km.num_threads = clusteringThreads();
+      km.seed = seed;
+      km.stopping = stopping;
+      km.profile = profile;
+
+      if (!sample_fractions.empty()) {
+        // Converge on samples first, then refine on the full data set
+        CoarseToFine ctf(sample_fractions);
+        ctf.run(km);
+        ctf.report();
+        std::cout << "Stopped by                : " << KrazyMeans::toString(km.stop_reason) << std::endl;
+
+        if (compare_cold_start) {
+          auto cold = KrazyMeans(ds, clusters, threshold_iters, scaling_factor);
+          cold.assignment = assignment;
+          cold.num_threads = clusteringThreads();
+          cold.seed = seed;
+          cold.stopping = stopping;
+          t.start();
+          cold.initialize();
+          cold.run();
+          t.stop();
+          std::cout << "Cold start                : " << cold.iteration << " iterations, " << t.seconds() << " s."
+                    << std::endl;
+          std::cout << "Full iterations saved     : "
+                    << (long) cold.iteration - (long) ctf.stages.back().iterations << std::endl;
+          std::cout << "Time saved                : " << t.seconds() - ctf.totalSeconds() << " s." << std::endl;
+        }
+      } else {
+        // Initialize algorithm
+        t.start();
+        km.initialize();
+        t.stop();
+        std::cout << "Algorithm initialization  : " << t.seconds() << " s." << std::endl;
 
-      // Initialize algorithm
-      t.start();
-      km.initialize();
-      t.stop();
-      std::cout << "Algorithm initialization  : " << t.seconds() << " s." << std::endl;
-
-      // Run algorithm
-      t.start();
-      km.run(false);
-      t.stop();
-      std::cout << "Reached convergence after : " << t.seconds() << " s." << std::endl;
-      std::cout << "Iterations                : " << km.iteration << std::endl;
+        // Run algorithm
+        t.start();
+        km.run(false);
+        t.stop();
+        std::cout << "Reached convergence after : " << t.seconds() << " s." << std::endl;
+        std::cout << "Iterations                : " << km.iteration << std::endl;
+        std::cout << "Stopped by                : " << KrazyMeans::toString(km.stop_reason) << std::endl;
+      }
+      if (countingAllocations()) {
+        // Nothing else runs while clustering a single data set, so any allocation was made by the iterations.
+        std::cout << "Allocations in iterations : " << km.loop_allocations << std::endl;
+        assert(km.loop_allocations == 0);
+      }
 
       // Write labels to file
       if (!output_file.empty()) {
         t.start();
+        if (profile) r = profile->begin();
         km.dumpLabels(output_file);
+        if (profile) profile->end("Writing", r);
         t.stop();
         std::cout << "Writing result            : " << t.seconds() << " s." << std::endl;
       } else {
         std::cerr << "No output file was specified." << std::endl;
       }
 
+      // Write centroids to file
+      if (!centroids_file.empty()) {
+        if (profile) r = profile->begin();
+        km.dumpCentroids(centroids_file);
+        if (profile) profile->end("Writing", r);
+      }
+
       if (plot_outputs) {
         std::ofstream points_out("points.csv");
         std::ofstream result_out("centroids.csv");
 
         if (points_out.good() && result_out.good()) {
+          t.start();
+          if (profile) r = profile->begin();
           km.printState(points_out, result_out);
+          if (profile) profile->end("Writing", r);
+          t.stop();
+          std::cout << "Writing CSV files         : " << t.seconds() << " s." << std::endl;
         } else {
           std::cerr << "Could not create CSV output files." << std::endl;
         }
       }
+
+      if (profile) {
+        std::cout << std::endl;
+        profile->report();
+      }
     } else {
       std::cerr << "No input file was specified." << std::endl;
     }
@@ -145,7 +502,7 @@ int main(int argc, char *argv[]) {
 
   // Use GNU getopt to parse command line options
   int opt;
-  while ((opt = getopt(argc, argv, "hi:o:k:t:s:pebf:v:")) != -1) {
+  while ((opt = getopt(argc, argv, "hi:o:z:x:m:j:l:c:P:D:M:C:q:k:t:s:R:a:y:u:n:w:g:GpebHr:f:v:")) != -1) {
     switch (opt) {
 
       case 'h': {
@@ -163,6 +520,71 @@ int main(int argc, char *argv[]) {
         break;
       }
 
+      case 'z': {
+        po.compressed_file = std::string(optarg);
+        break;
+      }
+
+      case 'x': {
+        po.csv_file = std::string(optarg);
+        break;
+      }
+
+      case 'm': {
+        po.manifest_file = std::string(optarg);
+        break;
+      }
+
+      case 'j': {
+        char *end;
+        po.threads = (unsigned int) std::strtol(optarg, &end, 10);
+        po.threads_given = true;
+        break;
+      }
+
+      case 'l': {
+        char *end;
+        po.stream_batch = (unsigned long) std::strtol(optarg, &end, 10);
+        break;
+      }
+
+      case 'c': {
+        po.centroids_file = std::string(optarg);
+        break;
+      }
+
+      case 'P': {
+        po.predict_file = std::string(optarg);
+        break;
+      }
+
+      case 'D': {
+        po.server_socket = std::string(optarg);
+        break;
+      }
+
+      case 'M': {
+        char *end;
+        po.cache_mib = (unsigned long) std::strtol(optarg, &end, 10);
+        break;
+      }
+
+      case 'C': {
+        po.client_socket = std::string(optarg);
+        break;
+      }
+
+      case 'q': {
+        po.shutdown_socket = std::string(optarg);
+        break;
+      }
+
+      case 'R': {
+        char *end;
+        po.seed = (int) std::strtol(optarg, &end, 10);
+        break;
+      }
+
       case 'k': {
         char *end;
         po.clusters = (unsigned int) std::strtol(optarg, &end, 10);
@@ -175,6 +597,12 @@ int main(int argc, char *argv[]) {
         break;
       }
 
+      case 'r': {
+        char *end;
+        po.sparse_density = std::strtof(optarg, &end);
+        break;
+      }
+
       case 'f': {
         char *end;
         po.features = (unsigned long) std::strtol(optarg, &end, 10);
@@ -193,6 +621,72 @@ int main(int argc, char *argv[]) {
         break;
       }
 
+      case 'a': {
+        std::string a(optarg);
+        if (a == "naive") {
+          po.assignment = KrazyMeans::Assignment::Naive;
+        } else if (a == "kdtree") {
+          po.assignment = KrazyMeans::Assignment::KdTree;
+        } else if (a == "auto") {
+          po.assignment = KrazyMeans::Assignment::Auto;
+        } else {
+          std::cerr << "Unknown assignment strategy: " << a << std::endl;
+          ProgramOptions::usage(argv);
+        }
+        break;
+      }
+
+      case 'y': {
+        char *end;
+        po.stopping.max_changed_fraction = std::strtod(optarg, &end);
+        break;
+      }
+
+      case 'u': {
+        char *end;
+        po.stopping.max_centroid_shift = std::strtof(optarg, &end);
+        break;
+      }
+
+      case 'n': {
+        char *end;
+        po.stopping.max_iterations = (unsigned int) std::strtol(optarg, &end, 10);
+        break;
+      }
+
+      case 'w': {
+        char *end;
+        po.stopping.time_budget = std::strtod(optarg, &end);
+        break;
+      }
+
+      case 'g': {
+        // Parse a comma-separated list of sample fractions
+        po.sample_fractions.clear();
+        char *pos = optarg;
+        while (*pos != '\0') {
+          char *end;
+          auto fraction = std::strtod(pos, &end);
+          if ((end == pos) || (fraction <= 0.0) || (fraction >= 1.0) ||
+              (!po.sample_fractions.empty() && (fraction <= po.sample_fractions.back()))) {
+            std::cerr << "Sample fractions must be increasing and between 0 and 1: " << optarg << std::endl;
+            ProgramOptions::usage(argv);
+          }
+          po.sample_fractions.push_back(fraction);
+          pos = (*end == ',') ? end + 1 : end;
+          if ((*end != ',') && (*end != '\0')) {
+            std::cerr << "Invalid sample fractions: " << optarg << std::endl;
+            ProgramOptions::usage(argv);
+          }
+        }
+        break;
+      }
+
+      case 'G': {
+        po.compare_cold_start = true;
+        break;
+      }
+
       case 'p': {
         po.plot_outputs = true;
         break;
@@ -208,6 +702,11 @@ int main(int argc, char *argv[]) {
         break;
       }
 
+      case 'H': {
+        po.hardware_counters = true;
+        break;
+      }
+
       case '?':
         if ((optopt == 'i') || (optopt == 'o')) {
           std::cerr << "Options -i and -o require an argument." << std::endl;
@@ -224,7 +723,12 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  po.run();
+  try {
+    po.run();
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
 
   return 0;
 }
@@ -0,0 +1,33 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <atomic>
+
+#include "Allocations.hpp"
+
+static std::atomic<AllocationCounter> allocation_counter(nullptr);
+
+void setAllocationCounter(AllocationCounter counter) {
+  allocation_counter.store(counter);
+}
+
+bool countingAllocations() {
+  return allocation_counter.load() != nullptr;
+}
+
+size_t heapAllocations() {
+  auto counter = allocation_counter.load();
+  return counter != nullptr ? counter() : 0;
+}
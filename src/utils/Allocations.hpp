@@ -0,0 +1,39 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Heap allocation accounting.
+ *
+ * The library doesn't replace the allocator of the program it is linked into. Instead, a program can install a
+ * counter of its heap allocations, which the library reads to check that the hot loops don't allocate. The command
+ * line tool and the tests do so with CountAllocations.cpp, which replaces the global operator new. The tool is built
+ * with it when KRAZYMEANS_COUNT_ALLOCATIONS is set, which is the default for debug builds.
+ */
+
+///@brief A function returning the number of heap allocations made by the whole process so far.
+typedef size_t (*AllocationCounter)();
+
+///@brief Install the counter of heap allocations. Passing nullptr removes it.
+void setAllocationCounter(AllocationCounter counter);
+
+///@brief Return whether heap allocations are counted.
+bool countingAllocations();
+
+///@brief Return the number of heap allocations made by the whole process, or zero when they are not counted.
+size_t heapAllocations();
@@ -0,0 +1,62 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <stdexcept>
+
+#include "CentroidFile.hpp"
+
+void writeCentroids(const std::string &file_name, const std::vector<FeatureVec> &centroids) {
+  std::ofstream file(file_name, std::ios::binary);
+
+  if (file.good()) {
+    size_t num_features = centroids.empty() ? 0 : centroids[0].size();
+    size_t num_centroids = centroids.size();
+    file.write((char *) &kmc_magic, sizeof(uint64_t));
+    file.write((char *) &num_features, sizeof(size_t));
+    file.write((char *) &num_centroids, sizeof(size_t));
+    for (auto &centroid : centroids) {
+      file.write((char *) centroid.values.data(), num_features * sizeof(float));
+    }
+  } else {
+    throw std::runtime_error("Could not write to file.");
+  }
+}
+
+std::vector<FeatureVec> readCentroids(const std::string &file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+
+  if (file.good()) {
+    uint64_t magic;
+    size_t num_features;
+    size_t num_centroids;
+    file.read((char *) &magic, sizeof(uint64_t));
+    if (magic != kmc_magic) {
+      throw std::runtime_error("Not a centroids file.");
+    }
+    file.read((char *) &num_features, sizeof(size_t));
+    file.read((char *) &num_centroids, sizeof(size_t));
+
+    std::vector<FeatureVec> centroids(num_centroids, FeatureVec(num_features, 0.0f));
+    for (auto &centroid : centroids) {
+      file.read((char *) centroid.values.data(), num_features * sizeof(float));
+    }
+    if (!file.good()) {
+      throw std::runtime_error("Centroids file is truncated.");
+    }
+    return centroids;
+  } else {
+    throw std::runtime_error("Could not load from file");
+  }
+}
@@ -0,0 +1,35 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FeatureVec.hpp"
+
+///@brief Magic number at the start of a binary centroids file ("KMC", version 1).
+constexpr uint64_t kmc_magic = 0x00000001434D4BULL;
+
+/**
+ * @brief Write centroids to a binary file.
+ *
+ * The file holds the magic number, the number of features and the number of centroids, followed by the row-major
+ * feature values of the centroids.
+ */
+void writeCentroids(const std::string &file_name, const std::vector<FeatureVec> &centroids);
+
+///@brief Read centroids from a binary file.
+std::vector<FeatureVec> readCentroids(const std::string &file_name);
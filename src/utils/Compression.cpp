@@ -0,0 +1,231 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Compression.hpp"
+
+// Plane storage methods
+static const uint8_t method_raw = 0;
+static const uint8_t method_lz = 1;
+
+// LZ codec parameters
+static const size_t min_match = 4;
+static const size_t max_offset = 65535;
+static const int hash_bits = 12;
+
+static inline uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline void writeLength(std::vector<uint8_t> &out, size_t len) {
+  while (len >= 255) {
+    out.push_back(255);
+    len -= 255;
+  }
+  out.push_back((uint8_t) len);
+}
+
+static void emitSequence(std::vector<uint8_t> &out,
+                         const uint8_t *literals,
+                         size_t num_literals,
+                         size_t offset,
+                         size_t match_len) {
+  auto lit_nibble = num_literals < 15 ? num_literals : 15;
+  auto match_nibble = (size_t) 0;
+  if (match_len != 0) {
+    match_nibble = match_len - min_match < 15 ? match_len - min_match : 15;
+  }
+  out.push_back((uint8_t) ((lit_nibble << 4) | match_nibble));
+  if (lit_nibble == 15) writeLength(out, num_literals - 15);
+  out.insert(out.end(), literals, literals + num_literals);
+
+  if (match_len != 0) {
+    out.push_back((uint8_t) (offset & 0xFF));
+    out.push_back((uint8_t) (offset >> 8));
+    if (match_nibble == 15) writeLength(out, match_len - min_match - 15);
+  }
+}
+
+// Compress a byte plane. The last sequence of the output always consists of literals only.
+static void compressPlane(const uint8_t *in, size_t n, std::vector<uint8_t> &out) {
+  long table[1 << hash_bits];
+  for (auto &t : table) t = -1;
+
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + min_match <= n) {
+    auto v = read32(in + i);
+    auto h = (v * 2654435761U) >> (32 - hash_bits);
+    auto candidate = table[h];
+    table[h] = (long) i;
+
+    if ((candidate >= 0) && (i - candidate <= max_offset) && (read32(in + candidate) == v)) {
+      auto len = min_match;
+      while ((i + len < n) && (in[candidate + len] == in[i + len])) len++;
+      emitSequence(out, in + anchor, i - anchor, i - candidate, len);
+      i += len;
+      anchor = i;
+    } else {
+      i++;
+    }
+  }
+  emitSequence(out, in + anchor, n - anchor, 0, 0);
+}
+
+static inline size_t readLength(const uint8_t *&sp, const uint8_t *end) {
+  size_t len = 0;
+  uint8_t b;
+  do {
+    if (sp >= end) throw std::runtime_error("Corrupt compressed block.");
+    b = *sp++;
+    len += b;
+  } while (b == 255);
+  return len;
+}
+
+static void decompressPlane(const uint8_t *sp, size_t src_size, uint8_t *out, size_t n) {
+  auto end = sp + src_size;
+  size_t dp = 0;
+
+  while (sp < end) {
+    auto token = *sp++;
+
+    // Literals
+    size_t num_literals = token >> 4;
+    if (num_literals == 15) num_literals += readLength(sp, end);
+    if ((num_literals > (size_t) (end - sp)) || (num_literals > n - dp)) {
+      throw std::runtime_error("Corrupt compressed block.");
+    }
+    std::memcpy(out + dp, sp, num_literals);
+    sp += num_literals;
+    dp += num_literals;
+
+    // The last sequence has no match.
+    if (sp == end) break;
+
+    // Match
+    if (end - sp < 2) throw std::runtime_error("Corrupt compressed block.");
+    size_t offset = sp[0] | ((size_t) sp[1] << 8);
+    sp += 2;
+    size_t match_len = (token & 0x0F) + min_match;
+    if ((token & 0x0F) == 15) match_len += readLength(sp, end);
+    if ((offset == 0) || (offset > dp) || (match_len > n - dp)) {
+      throw std::runtime_error("Corrupt compressed block.");
+    }
+    // Matches may overlap with their own output, so copy byte by byte.
+    auto match = out + dp - offset;
+    for (size_t b = 0; b < match_len; b++) {
+      out[dp + b] = match[b];
+    }
+    dp += match_len;
+  }
+
+  if (dp != n) throw std::runtime_error("Corrupt compressed block.");
+}
+
+size_t compressBlock(const float *src, size_t num_vectors, size_t num_features, std::vector<uint8_t> &dst) {
+  auto num_words = num_vectors * num_features;
+  auto start = dst.size();
+  if (num_words > UINT32_MAX) {
+    throw std::runtime_error("Compressed blocks must hold fewer than 2^32 feature values.");
+  }
+
+  // Delta against the previous vector and split the words into byte planes.
+  std::vector<uint8_t> planes(4 * num_words);
+  for (size_t w = 0; w < num_words; w++) {
+    uint32_t u;
+    std::memcpy(&u, src + w, sizeof(u));
+    if (w >= num_features) {
+      uint32_t prev;
+      std::memcpy(&prev, src + w - num_features, sizeof(prev));
+      u ^= prev;
+    }
+    planes[w] = (uint8_t) (u >> 24);
+    planes[num_words + w] = (uint8_t) (u >> 16);
+    planes[2 * num_words + w] = (uint8_t) (u >> 8);
+    planes[3 * num_words + w] = (uint8_t) u;
+  }
+
+  // Compress every plane, falling back to raw storage if compression doesn't help.
+  std::vector<uint8_t> compressed;
+  for (size_t p = 0; p < 4; p++) {
+    auto plane = planes.data() + p * num_words;
+    compressed.clear();
+    compressPlane(plane, num_words, compressed);
+
+    auto method = compressed.size() < num_words ? method_lz : method_raw;
+    auto size = (uint32_t) (method == method_lz ? compressed.size() : num_words);
+    dst.push_back(method);
+    dst.insert(dst.end(), (uint8_t *) &size, (uint8_t *) &size + sizeof(size));
+    if (method == method_lz) {
+      dst.insert(dst.end(), compressed.begin(), compressed.end());
+    } else {
+      dst.insert(dst.end(), plane, plane + num_words);
+    }
+  }
+
+  return dst.size() - start;
+}
+
+void decompressBlock(const uint8_t *src,
+                     size_t src_size,
+                     float *dst,
+                     size_t num_vectors,
+                     size_t num_features,
+                     std::vector<uint8_t> &scratch) {
+  auto num_words = num_vectors * num_features;
+  auto end = src + src_size;
+
+  scratch.resize(4 * num_words);
+
+  // Decode the byte planes
+  for (size_t p = 0; p < 4; p++) {
+    if (end - src < 5) throw std::runtime_error("Corrupt compressed block.");
+    auto method = src[0];
+    uint32_t size;
+    std::memcpy(&size, src + 1, sizeof(size));
+    src += 5;
+    if (size > (size_t) (end - src)) throw std::runtime_error("Corrupt compressed block.");
+
+    auto plane = scratch.data() + p * num_words;
+    if (method == method_raw) {
+      if (size != num_words) throw std::runtime_error("Corrupt compressed block.");
+      std::memcpy(plane, src, num_words);
+    } else if (method == method_lz) {
+      decompressPlane(src, size, plane, num_words);
+    } else {
+      throw std::runtime_error("Unknown compression method.");
+    }
+    src += size;
+  }
+
+  // Merge the planes and undo the delta, straight into the destination.
+  auto p0 = scratch.data();
+  auto p1 = p0 + num_words;
+  auto p2 = p1 + num_words;
+  auto p3 = p2 + num_words;
+  for (size_t w = 0; w < num_words; w++) {
+    auto u = ((uint32_t) p0[w] << 24) | ((uint32_t) p1[w] << 16) | ((uint32_t) p2[w] << 8) | (uint32_t) p3[w];
+    if (w >= num_features) {
+      uint32_t prev;
+      std::memcpy(&prev, dst + w - num_features, sizeof(prev));
+      u ^= prev;
+    }
+    std::memcpy(dst + w, &u, sizeof(u));
+  }
+}
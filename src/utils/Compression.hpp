@@ -0,0 +1,59 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Block compression of feature values.
+ *
+ * A block of feature vectors is first transformed so that similar bytes end up next to each other: every float is
+ * XOR-ed with the same feature of the previous vector in the block, after which the bytes are split into four planes
+ * (sign/exponent byte first, least significant mantissa byte last). Each plane is then compressed with a small
+ * LZ77-style codec, or stored as-is when that does not pay off. Blocks do not depend on each other, so they can be
+ * decoded in parallel.
+ */
+
+///@brief Magic number at the start of a compressed .kmd file ("KMDZ", version 1).
+constexpr uint64_t kmdz_magic = 0x000000015A444D4BULL;
+
+/**
+ * @brief Compress a block of feature vectors.
+ * @param src           Row-major feature values of the block.
+ * @param num_vectors   Number of vectors in the block.
+ * @param num_features  Number of features per vector.
+ * @param dst           Output buffer. The compressed block is appended to it.
+ * @return The number of bytes appended to \p dst.
+ * @throws std::runtime_error if the block holds 2^32 feature values or more.
+ */
+size_t compressBlock(const float *src, size_t num_vectors, size_t num_features, std::vector<uint8_t> &dst);
+
+/**
+ * @brief Decompress a block of feature vectors.
+ * @param src           The compressed block.
+ * @param src_size      Size of the compressed block in bytes.
+ * @param dst           Row-major destination for the feature values of the block.
+ * @param num_vectors   Number of vectors in the block.
+ * @param num_features  Number of features per vector.
+ * @param scratch       Scratch buffer, reused between calls to avoid allocations.
+ */
+void decompressBlock(const uint8_t *src,
+                     size_t src_size,
+                     float *dst,
+                     size_t num_vectors,
+                     size_t num_features,
+                     std::vector<uint8_t> &scratch);
@@ -0,0 +1,74 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Replaces the global operator new to count the heap allocations of the process, and installs the counter for the
+// library (see Allocations.hpp). This file is linked into programs, never into the library itself, so that the
+// library doesn't replace the allocator of the programs that use it.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "Allocations.hpp"
+
+static std::atomic<size_t> process_allocations(0);
+
+// Allocate like the default operator new, but count the allocation.
+static void *countedAllocate(std::size_t size) {
+  process_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  while (true) {
+    auto ptr = std::malloc(size);
+    if (ptr != nullptr) return ptr;
+    auto handler = std::get_new_handler();
+    if (handler == nullptr) throw std::bad_alloc();
+    handler();
+  }
+}
+
+void *operator new(std::size_t size) { return countedAllocate(size); }
+
+void *operator new[](std::size_t size) { return countedAllocate(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return countedAllocate(size);
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return countedAllocate(size);
+  } catch (std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+
+static size_t countedAllocations() {
+  return process_allocations.load(std::memory_order_relaxed);
+}
+
+// Install the counter before main() runs.
+static const bool installed = (setAllocationCounter(countedAllocations), true);
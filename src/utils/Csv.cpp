@@ -0,0 +1,270 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <omp.h>
+
+#include "Csv.hpp"
+
+// Maximum size of the buffer a thread formats lines into at once, in bytes.
+static const size_t chunk_bytes = 4 << 20;
+
+// Write an unsigned integer, return the number of characters written.
+static size_t formatUnsigned(uint64_t value, char *out) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = (char) ('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = digits[n - 1 - i];
+  }
+  return n;
+}
+
+size_t formatFloat(float value, char *out) {
+  double d = value;
+  // Leave special and huge values to the C library. Infinity and NaN are recognized by their bits, since the compiler
+  // may assume that floating point values are finite.
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  if (((bits & 0x7F800000u) == 0x7F800000u) || (std::fabs(d) >= 1e15)) {
+    return (size_t) std::snprintf(out, max_float_chars, "%f", d);
+  }
+
+  // The sign is taken from the bits as well, since the compiler may also ignore the sign of zero.
+  bool negative = (bits >> 31) != 0;
+  size_t n = 0;
+  if (negative) {
+    d = -d;
+  }
+  auto integer = (uint64_t) d;
+  // A float has 24 significant bits, so the fraction times 10^6 is exact in a double, and rounding it to the nearest
+  // even integer is exactly what printf does.
+  auto fraction = (uint64_t) std::nearbyint((d - (double) integer) * 1e6);
+  if (fraction == 1000000) {
+    integer++;
+    fraction = 0;
+  }
+
+  if (negative) {
+    out[n++] = '-';
+  }
+  n += formatUnsigned(integer, out + n);
+  out[n++] = '.';
+  for (int i = 5; i >= 0; i--) {
+    out[n + i] = (char) ('0' + fraction % 10);
+    fraction /= 10;
+  }
+  return n + 6;
+}
+
+// Format lines in parallel chunks and write them in order. The formatter writes line l to a buffer and returns the
+// number of characters written, which may be at most max_line_chars. Every chunk fits in chunk_bytes, so the buffers
+// don't grow with the width of the data. Every round formats a chunk per thread, but doesn't rely on getting that
+// many threads.
+template<typename Formatter>
+static void writeLines(std::ostream &os, size_t num_lines, size_t max_line_chars, Formatter format) {
+  auto lines_per_chunk = std::max((size_t) 1, chunk_bytes / max_line_chars);
+  auto num_chunks = std::min((size_t) omp_get_max_threads(), (num_lines + lines_per_chunk - 1) / lines_per_chunk);
+  std::vector<std::string> buffers(num_chunks);
+  std::vector<size_t> sizes(num_chunks);
+
+  for (size_t first = 0; first < num_lines; first += num_chunks * lines_per_chunk) {
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t c = 0; c < num_chunks; c++) {
+      auto begin = std::min(num_lines, first + c * lines_per_chunk);
+      auto end = std::min(num_lines, begin + lines_per_chunk);
+      auto &buffer = buffers[c];
+      buffer.resize((end - begin) * max_line_chars);
+      size_t n = 0;
+      for (size_t l = begin; l < end; l++) {
+        n += format(l, &buffer[n]);
+      }
+      sizes[c] = n;
+    }
+    for (size_t c = 0; c < num_chunks; c++) {
+      os.write(buffers[c].data(), sizes[c]);
+    }
+  }
+}
+
+// Write the features of a vector, separated by commas.
+static size_t formatFeatures(const float *features, size_t num_features, char *out) {
+  size_t n = 0;
+  for (size_t f = 0; f < num_features; f++) {
+    n += formatFloat(features[f], out + n);
+    if (f < num_features - 1) {
+      out[n++] = ',';
+      out[n++] = ' ';
+    }
+  }
+  return n;
+}
+
+void writeCsv(std::ostream &os, DataSet &data_set, const size_t *labels) {
+  auto F = data_set.num_features;
+  auto max_line_chars = 2 * 22 + F * (max_float_chars + 2) + 1;
+
+  writeLines(os, data_set.size(), max_line_chars, [&](size_t v, char *out) {
+    size_t n = 0;
+    if (labels != nullptr) {
+      n += formatUnsigned(v, out + n);
+      out[n++] = ',';
+      out[n++] = ' ';
+      n += formatUnsigned(labels[v], out + n);
+      out[n++] = ',';
+      out[n++] = ' ';
+    }
+    n += formatFeatures(data_set.vector(v), F, out + n);
+    out[n++] = '\n';
+    return n;
+  });
+}
+
+void writeCsv(std::ostream &os, const std::vector<FeatureVec> &centroids) {
+  auto F = centroids.empty() ? 0 : centroids[0].size();
+  auto max_line_chars = 22 + F * (max_float_chars + 2) + 1;
+
+  writeLines(os, centroids.size(), max_line_chars, [&](size_t c, char *out) {
+    size_t n = formatUnsigned(c, out);
+    out[n++] = ',';
+    out[n++] = ' ';
+    n += formatFeatures(centroids[c].values.data(), F, out + n);
+    out[n++] = '\n';
+    return n;
+  });
+}
+
+bool isCsvFile(const std::string &file_name) {
+  auto csv = std::string(".csv");
+  return (file_name.size() >= csv.size()) && (file_name.compare(file_name.size() - csv.size(), csv.size(), csv) == 0);
+}
+
+// Return whether a line of text starts with a number.
+static bool isNumeric(const char *p, const char *end) {
+  while ((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+  return (p < end) && (std::strchr("+-.0123456789", *p) != nullptr) && (*p != '\0');
+}
+
+void readCsv(const std::string &file_name, DataSet &data_set) {
+  std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+  if (!file.good()) {
+    throw std::runtime_error("Could not load from file");
+  }
+
+  // Read the whole file, terminated by a zero so strtof can't run off the end.
+  std::vector<char> text((size_t) file.tellg() + 1);
+  file.seekg(0);
+  file.read(text.data(), text.size() - 1);
+  text.back() = '\0';
+  const char *begin = text.data();
+  const char *end = text.data() + text.size() - 1;
+
+  // Skip a header line.
+  auto first_end = (const char *) std::memchr(begin, '\n', end - begin);
+  if (first_end == nullptr) first_end = end;
+  if (!isNumeric(begin, first_end)) {
+    begin = first_end == end ? end : first_end + 1;
+    first_end = (const char *) std::memchr(begin, '\n', end - begin);
+    if (first_end == nullptr) first_end = end;
+  }
+
+  // The first line determines the number of features.
+  size_t num_features = 1;
+  for (auto p = begin; p < first_end; p++) {
+    if (*p == ',') num_features++;
+  }
+
+  // Split the text into chunks at line boundaries.
+  auto num_chunks = (size_t) omp_get_max_threads() * 4;
+  std::vector<const char *> bounds(num_chunks + 1, end);
+  bounds[0] = begin;
+  for (size_t c = 1; c < num_chunks; c++) {
+    auto p = std::max(bounds[c - 1], begin + (end - begin) * c / num_chunks);
+    while ((p < end) && (p > begin) && (p[-1] != '\n')) p++;
+    bounds[c] = p;
+  }
+
+  // Count the non-empty lines in every chunk, to know where each chunk starts in the data set.
+  std::vector<size_t> offsets(num_chunks + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t c = 0; c < num_chunks; c++) {
+    size_t lines = 0;
+    bool empty = true;
+    for (auto p = bounds[c]; p < bounds[c + 1]; p++) {
+      if (*p == '\n') {
+        if (!empty) lines++;
+        empty = true;
+      } else if ((*p != '\r') && (*p != ' ')) {
+        empty = false;
+      }
+    }
+    if (!empty) lines++;
+    offsets[c + 1] = lines;
+  }
+  for (size_t c = 0; c < num_chunks; c++) {
+    offsets[c + 1] += offsets[c];
+  }
+
+  data_set.num_features = num_features;
+  data_set.resize(offsets[num_chunks]);
+
+  // Parse the chunks directly into the data set.
+  bool failed = false;
+#pragma omp parallel for schedule(dynamic)
+  for (size_t c = 0; c < num_chunks; c++) {
+    auto p = bounds[c];
+    auto chunk_end = bounds[c + 1];
+    auto v = offsets[c];
+    bool malformed = false;
+    while ((p < chunk_end) && !malformed) {
+      // Skip empty lines.
+      while ((p < chunk_end) && ((*p == '\n') || (*p == '\r') || (*p == ' '))) p++;
+      if (p >= chunk_end) break;
+
+      auto vec = data_set.vector(v++);
+      for (size_t f = 0; (f < num_features) && !malformed; f++) {
+        // Don't let strtof skip over the end of the line.
+        while ((*p == ' ') || (*p == '\t')) p++;
+        char *next;
+        vec[f] = std::strtof(p, &next);
+        malformed = (next == p) || (*p == '\n');
+        p = next;
+        while ((p < chunk_end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) p++;
+        if (f < num_features - 1) {
+          malformed = malformed || (p >= chunk_end) || (*p != ',');
+          p++;
+        }
+      }
+      // The line must end here.
+      malformed = malformed || ((p < chunk_end) && (*p != '\n'));
+    }
+    if (malformed) {
+#pragma omp atomic write
+      failed = true;
+    }
+  }
+
+  if (failed) {
+    throw std::runtime_error("Malformed CSV file, all lines must hold the same number of numbers.");
+  }
+}
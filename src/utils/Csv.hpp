@@ -0,0 +1,62 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DataSet.hpp"
+#include "FeatureVec.hpp"
+
+/**
+ * @brief Format a float with six decimals, like std::to_string, without going through the C locale machinery.
+ * @param value   The value to format.
+ * @param out     The buffer to write to. Must have room for at least max_float_chars characters.
+ * @return The number of characters written.
+ */
+size_t formatFloat(float value, char *out);
+
+///@brief The maximum number of characters formatFloat writes.
+const size_t max_float_chars = 56;
+
+///@brief Return whether \p file_name is a CSV file, which is recognized by its .csv extension.
+bool isCsvFile(const std::string &file_name);
+
+/**
+ * @brief Load a data set from a CSV file with one vector per line, in parallel.
+ *
+ * All lines must have the same number of comma-separated values. A first line that does not start with a number is
+ * skipped as a header.
+ *
+ * @param file_name   The CSV file.
+ * @param data_set    The data set to load into. Its storage is reused.
+ */
+void readCsv(const std::string &file_name, DataSet &data_set);
+
+/**
+ * @brief Write a data set as CSV, formatting the lines in parallel.
+ *
+ * Without labels, every line holds the features of a vector. With labels, every line holds the index of the vector,
+ * its label and its features, which is the format KrazyMeans::printState uses for the points.
+ *
+ * @param os          The stream to write to.
+ * @param data_set    The data set.
+ * @param labels      The label of every vector, or nullptr.
+ */
+void writeCsv(std::ostream &os, DataSet &data_set, const size_t *labels = nullptr);
+
+///@brief Write centroids as CSV, with the index of the centroid followed by its features on every line.
+void writeCsv(std::ostream &os, const std::vector<FeatureVec> &centroids);
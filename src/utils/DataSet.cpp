@@ -12,15 +12,38 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <omp.h>
 
 #include "DataSet.hpp"
+#include "Compression.hpp"
+#include "Csv.hpp"
 #include "RandomGenerator.hpp"
 
+std::shared_ptr<DataSet> DataSet::wrap(float *data, size_t num_vectors, size_t num_features, size_t stride) {
+  if (stride < num_features) {
+    throw std::runtime_error("Stride is smaller than the number of features.");
+  }
+  auto ds = std::make_shared<DataSet>(num_features);
+  ds->stride = stride;
+  ds->data = data;
+  ds->num_vectors = num_vectors;
+  ds->borrowed = true;
+  return ds;
+}
+
+void DataSet::useOwnedStorage() {
+  borrowed = false;
+  stride = num_features;
+  data = values.data();
+  num_vectors = num_features == 0 ? 0 : values.size() / num_features;
+}
+
 void DataSet::addVector(FeatureVec &f) {
   if (num_features == f.size()) {
-    vectors.push_back(f);
+    append(f.values.data(), 1);
   } else {
     throw std::runtime_error("Feature vector is of different length than number of required features in DataSet.");
   }
@@ -28,12 +51,29 @@ void DataSet::addVector(FeatureVec &f) {
 
 void DataSet::addVector(std::vector<float> &f) {
   if (num_features == f.size()) {
-    vectors.emplace_back(f);
+    append(f.data(), 1);
   } else {
     throw std::runtime_error("Feature vector is of different length than number of required features in DataSet.");
   }
 }
 
+void DataSet::append(const float *vectors, size_t count) {
+  if (borrowed) {
+    // Take a copy of the borrowed vectors first.
+    values.resize(num_vectors * num_features);
+    for (size_t v = 0; v < num_vectors; v++) {
+      std::copy(vector(v), vector(v) + num_features, &values[v * num_features]);
+    }
+  }
+  values.insert(values.end(), vectors, vectors + count * num_features);
+  useOwnedStorage();
+}
+
+void DataSet::resize(size_t count) {
+  values.resize(count * num_features);
+  useOwnedStorage();
+}
+
 void DataSet::toFile(std::string file_name) {
   // Open the file
   std::ofstream file(file_name, std::ios::binary);
@@ -46,9 +86,11 @@ void DataSet::toFile(std::string file_name) {
     file.write((char *) &s, sizeof(size_t));
 
     // Write vectors
-    for (size_t v = 0; v < size(); v++) {
-      for (size_t f = 0; f < num_features; f++) {
-        file.write((char *) &vector(v)[f], sizeof(float));
+    if (isContiguous()) {
+      file.write((char *) vector(0), s * num_features * sizeof(float));
+    } else {
+      for (size_t v = 0; v < s; v++) {
+        file.write((char *) vector(v), num_features * sizeof(float));
       }
     }
   } else {
@@ -56,31 +98,161 @@ void DataSet::toFile(std::string file_name) {
   }
 }
 
-std::shared_ptr<DataSet> DataSet::fromFile(const std::string &file_name) {
-  auto ds = std::make_shared<DataSet>();
+void DataSet::toCompressedFile(const std::string &file_name, size_t block_vectors) {
+  std::ofstream file(file_name, std::ios::binary);
+
+  if (!file.good()) {
+    throw std::runtime_error("Could not write to file.");
+  }
+
+  // The size of every byte plane of a block is stored in 32 bits, so shrink the blocks if needed.
+  auto max_block_vectors = std::max((size_t) 1, (size_t) UINT32_MAX / std::max(num_features, (size_t) 1));
+  block_vectors = std::max((size_t) 1, std::min(block_vectors, max_block_vectors));
+
+  auto s = size();
+  size_t num_blocks = (s + block_vectors - 1) / block_vectors;
+
+  // Compress all blocks in parallel
+  std::vector<std::vector<uint8_t>> blocks(num_blocks);
+#pragma omp parallel
+  {
+    std::vector<float> rows;
+#pragma omp for schedule(dynamic)
+    for (size_t b = 0; b < num_blocks; b++) {
+      auto first = b * block_vectors;
+      auto count = std::min(block_vectors, s - first);
+      if (isContiguous()) {
+        compressBlock(vector(first), count, num_features, blocks[b]);
+      } else {
+        // Gather the vectors of the block first.
+        rows.resize(count * num_features);
+        for (size_t v = 0; v < count; v++) {
+          std::copy(vector(first + v), vector(first + v) + num_features, &rows[v * num_features]);
+        }
+        compressBlock(rows.data(), count, num_features, blocks[b]);
+      }
+    }
+  }
+
+  // Write the header, followed by the size of every block and the blocks themselves.
+  file.write((char *) &kmdz_magic, sizeof(uint64_t));
+  file.write((char *) &num_features, sizeof(size_t));
+  file.write((char *) &s, sizeof(size_t));
+  file.write((char *) &block_vectors, sizeof(size_t));
+  file.write((char *) &num_blocks, sizeof(size_t));
+  for (auto &block : blocks) {
+    size_t block_size = block.size();
+    file.write((char *) &block_size, sizeof(size_t));
+  }
+  for (auto &block : blocks) {
+    file.write((char *) block.data(), block.size());
+  }
+}
+
+// Load the remainder of a compressed file, after the magic number.
+static void loadCompressed(std::ifstream &file, DataSet &ds) {
+  size_t size;
+  size_t block_vectors;
+  size_t num_blocks;
+  file.read((char *) &ds.num_features, sizeof(size_t));
+  file.read((char *) &size, sizeof(size_t));
+  file.read((char *) &block_vectors, sizeof(size_t));
+  file.read((char *) &num_blocks, sizeof(size_t));
+  if (!file.good() || (block_vectors == 0) || (num_blocks != (size + block_vectors - 1) / block_vectors)) {
+    throw std::runtime_error("Corrupt compressed data set header.");
+  }
+
+  ds.resize(size);
+  if (num_blocks == 0) {
+    return;
+  }
+
+  // Turn the block sizes into offsets in the payload.
+  std::vector<size_t> offsets(num_blocks + 1, 0);
+  file.read((char *) &offsets[1], num_blocks * sizeof(size_t));
+  if (!file.good()) {
+    throw std::runtime_error("Compressed data set is truncated.");
+  }
+  for (size_t b = 0; b < num_blocks; b++) {
+    offsets[b + 1] += offsets[b];
+  }
+
+  std::vector<uint8_t> payload(offsets[num_blocks]);
+  std::vector<std::vector<uint8_t>> scratch((size_t) omp_get_max_threads());
+  bool truncated = false;
+  bool failed = false;
+
+  // One thread reads the blocks in order, and every block that was read is decompressed by a task directly into the
+  // data set, while the next blocks are being read.
+#pragma omp parallel
+#pragma omp single
+  {
+    for (size_t b = 0; b < num_blocks; b++) {
+      file.read((char *) &payload[offsets[b]], offsets[b + 1] - offsets[b]);
+      if (!file.good()) {
+        truncated = true;
+        break;
+      }
+#pragma omp task firstprivate(b) shared(payload, offsets, scratch, failed, ds)
+      {
+        auto first = b * block_vectors;
+        auto count = std::min(block_vectors, size - first);
+        try {
+          decompressBlock(&payload[offsets[b]], offsets[b + 1] - offsets[b], ds.vector(first), count,
+                          ds.num_features, scratch[omp_get_thread_num()]);
+        } catch (std::runtime_error &e) {
+#pragma omp atomic write
+          failed = true;
+        }
+      }
+    }
+  }
+
+  if (truncated) {
+    throw std::runtime_error("Compressed data set is truncated.");
+  }
+  if (failed) {
+    throw std::runtime_error("Could not decompress data set.");
+  }
+}
+
+void DataSet::load(const std::string &file_name) {
+  if (isCsvFile(file_name)) {
+    readCsv(file_name, *this);
+    return;
+  }
 
   std::ifstream file(file_name, std::ios::binary);
 
   if (file.good()) {
-    // Read num features
-    file.read((char *) &ds->num_features, sizeof(size_t));
+    // Read num features, or the magic number of a compressed file
+    uint64_t magic;
+    file.read((char *) &magic, sizeof(uint64_t));
+    if (magic == kmdz_magic) {
+      loadCompressed(file, *this);
+      return;
+    }
+    num_features = magic;
     size_t size;
     // Read number of vectors
     file.read((char *) &size, sizeof(size_t));
-    ds->vectors.reserve(size);
-    for (size_t v = 0; v < size; v++) {
-      std::vector<float> vec(ds->num_features);
-      for (size_t f = 0; f < ds->num_features; f++) {
-        file.read((char *) &vec[f], sizeof(float));
-      }
-      ds->addVector(vec);
+    // Read all vectors at once
+    resize(size);
+    file.read((char *) vector(0), size * num_features * sizeof(float));
+    if (!file.good()) {
+      throw std::runtime_error("Data set file is truncated.");
     }
-    return ds;
   } else {
     throw std::runtime_error("Could not load from file");
   }
+}
 
+std::shared_ptr<DataSet> DataSet::fromFile(const std::string &file_name) {
+  auto ds = std::make_shared<DataSet>();
+  ds->load(file_name);
+  return ds;
 }
+
 std::shared_ptr<DataSet> DataSet::random(size_t num_features, size_t num_vectors, int num_clusters) {
 
   // Fully randomize feature vectors if number of centroids is negative.
@@ -20,13 +20,34 @@
 
 #include "FeatureVec.hpp"
 
-// A data set with vectors
+/**
+ * @brief A data set with vectors
+ *
+ * The feature values are either owned by the data set, in which case they are stored contiguously in row-major order,
+ * or borrowed from a buffer of the caller (see DataSet::wrap), in which case consecutive vectors may be further apart
+ * than the number of features.
+ */
 struct DataSet {
   size_t num_features = 0;
-  std::vector<FeatureVec> vectors;
+
+  ///@brief The distance between consecutive vectors, in floats.
+  size_t stride = 0;
 
   ///@brief Construct a new data set with \p num_features features in the feature vectors.
-  explicit DataSet(size_t num_features = 1) : num_features(num_features) {};
+  explicit DataSet(size_t num_features = 1) : num_features(num_features), stride(num_features) {};
+
+  /**
+   * @brief Create a DataSet that borrows the feature values of a buffer owned by the caller, without copying them.
+   *
+   * The buffer must outlive the DataSet. Adding vectors to a borrowing DataSet copies the borrowed vectors to storage
+   * of its own first. Resizing or loading into it replaces the borrowed vectors.
+   *
+   * @param data          The feature values of the first vector.
+   * @param num_vectors   The number of vectors.
+   * @param num_features  The number of features per vector.
+   * @param stride        The distance between consecutive vectors, in floats. At least \p num_features.
+   */
+  static std::shared_ptr<DataSet> wrap(float *data, size_t num_vectors, size_t num_features, size_t stride);
 
   /**
    * @brief     Add a feature vector to the data set.
@@ -40,21 +61,70 @@ struct DataSet {
    */
   void addVector(std::vector<float> &f);
 
-  ///@brief Access the vector at index \p idx
-  inline FeatureVec &vector(size_t idx) { return vectors[idx]; }
+  /**
+   * @brief               Add feature vectors to the data set.
+   * @param vectors       Row-major features of the vectors (a copy is made).
+   * @param num_vectors   The number of vectors.
+   */
+  void append(const float *vectors, size_t num_vectors);
 
-  ///@brief Access the vector at index \p idx
-  inline FeatureVec &operator[](size_t idx) { return vector(idx); }
+  ///@brief Resize the data set to hold \p num_vectors vectors. New vectors are zero.
+  void resize(size_t num_vectors);
+
+  ///@brief Remove all vectors from the data set. Owned storage is kept for reuse.
+  inline void clear() { resize(0); }
+
+  ///@brief Access the features of the vector at index \p idx
+  inline float *vector(size_t idx) { return data + idx * stride; }
+
+  ///@brief Access the features of the vector at index \p idx
+  inline float *operator[](size_t idx) { return vector(idx); }
 
   ///@brief Return the number of feature vectors in the data set.
-  inline size_t size() const { return vectors.size(); }
+  inline size_t size() const { return num_vectors; }
+
+  ///@brief Return whether the vectors are stored back to back.
+  inline bool isContiguous() const { return stride == num_features; }
+
+  ///@brief Return whether the feature values are borrowed from the caller.
+  inline bool isBorrowed() const { return borrowed; }
 
   ///@brief Write the DataSet to file
   void toFile(std::string file_name);
 
-  ///@brief Load a DataSet from a file
+  /**
+   * @brief Write the DataSet to a compressed file.
+   * @param file_name       The file to write to.
+   * @param block_vectors   Number of vectors per independently decodable block. Blocks are made smaller if they would
+   *                        hold 2^32 feature values or more.
+   */
+  void toCompressedFile(const std::string &file_name, size_t block_vectors = 16384);
+
+  /**
+   * @brief Replace the contents of this DataSet with those of a file. The raw and the compressed format are
+   * accepted, as well as CSV files with a .csv extension. The storage of this DataSet is reused where possible.
+   */
+  void load(const std::string &file_name);
+
+  ///@brief Load a DataSet from a file. See DataSet::load for the accepted formats.
   static std::shared_ptr<DataSet> fromFile(const std::string &file_name);
 
   ///@brief Create a random DataSet
   static std::shared_ptr<DataSet> random(size_t features, size_t vectors, int num_clusters=-1);
-};
\ No newline at end of file
+
+ private:
+  ///@brief The feature values, if they are owned by this DataSet.
+  std::vector<float> values;
+
+  ///@brief The features of the first vector.
+  float *data = nullptr;
+
+  ///@brief The number of vectors.
+  size_t num_vectors = 0;
+
+  ///@brief Whether the feature values are borrowed from the caller.
+  bool borrowed = false;
+
+  ///@brief Switch to the owned storage after it was modified.
+  void useOwnedStorage();
+};
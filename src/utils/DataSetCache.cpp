@@ -0,0 +1,84 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/stat.h>
+
+#include "DataSetCache.hpp"
+
+// Return the modification time of a file in nanoseconds.
+static long modificationTime(const std::string &file_name) {
+  struct stat st{};
+  if (stat(file_name.c_str(), &st) != 0) {
+    throw std::runtime_error("Could not load from file");
+  }
+  return st.st_mtim.tv_sec * 1000000000L + st.st_mtim.tv_nsec;
+}
+
+std::shared_ptr<DataSet> DataSetCache::get(const std::string &file_name, bool *hit) {
+  auto mtime = modificationTime(file_name);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(file_name);
+    if ((it != entries.end()) && (it->second.mtime == mtime)) {
+      // Mark as most recently used.
+      recent.splice(recent.begin(), recent, it->second.lru);
+      if (hit != nullptr) *hit = true;
+      return it->second.data_set;
+    }
+  }
+
+  // Load without holding the lock, so other requests can continue.
+  auto ds = DataSet::fromFile(file_name);
+  if (hit != nullptr) *hit = false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(file_name);
+  if (it != entries.end()) {
+    // Replace a stale entry, or one that was loaded concurrently.
+    used -= it->second.bytes;
+    recent.erase(it->second.lru);
+    entries.erase(it);
+  }
+  recent.push_front(file_name);
+  Entry entry;
+  entry.data_set = ds;
+  entry.mtime = mtime;
+  entry.bytes = ds->size() * ds->num_features * sizeof(float);
+  entry.lru = recent.begin();
+  used += entry.bytes;
+  entries[file_name] = entry;
+  evict();
+  return ds;
+}
+
+void DataSetCache::evict() {
+  // Always keep the most recently used data set.
+  while ((used > capacity) && (recent.size() > 1)) {
+    auto &entry = entries[recent.back()];
+    used -= entry.bytes;
+    entries.erase(recent.back());
+    recent.pop_back();
+  }
+}
+
+size_t DataSetCache::bytes() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return used;
+}
+
+size_t DataSetCache::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
@@ -0,0 +1,69 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "DataSet.hpp"
+
+/**
+ * @brief A cache of loaded data sets, keyed by file name.
+ *
+ * When the total size of the cached data sets exceeds the memory cap, the least recently used data sets are evicted.
+ * Data sets that are still in use elsewhere stay alive until they are released, but are no longer accounted for.
+ * A cached data set is reloaded when its file has been modified.
+ */
+struct DataSetCache {
+  ///@brief Construct a new cache that holds at most \p capacity bytes of feature values.
+  explicit DataSetCache(size_t capacity) : capacity(capacity) {}
+
+  /**
+   * @brief Return the data set stored in a file, loading it if it's not in the cache.
+   * @param file_name   The data set file.
+   * @param hit         Output: whether the data set was in the cache.
+   * @return The data set.
+   */
+  std::shared_ptr<DataSet> get(const std::string &file_name, bool *hit = nullptr);
+
+  ///@brief Return the number of bytes of feature values in the cache.
+  size_t bytes();
+
+  ///@brief Return the number of data sets in the cache.
+  size_t size();
+
+ private:
+  struct Entry {
+    std::shared_ptr<DataSet> data_set;
+    ///@brief Modification time of the file when it was loaded.
+    long mtime = 0;
+    size_t bytes = 0;
+    std::list<std::string>::iterator lru;
+  };
+
+  ///@brief Evict least recently used data sets until the cache fits its capacity.
+  void evict();
+
+  size_t capacity = 0;
+  size_t used = 0;
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  ///@brief File names from most to least recently used.
+  std::list<std::string> recent;
+};
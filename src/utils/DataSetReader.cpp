@@ -0,0 +1,89 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "DataSetReader.hpp"
+#include "Compression.hpp"
+#include "Csv.hpp"
+
+DataSetReader::DataSetReader(const std::string &file_name) : file(file_name, std::ios::binary) {
+  if (isCsvFile(file_name)) {
+    throw std::runtime_error("CSV files can't be read in batches, convert " + file_name + " to .kmd first, e.g. with -z.");
+  }
+  if (!file.good()) {
+    throw std::runtime_error("Could not load from file");
+  }
+  file.read((char *) &num_features, sizeof(size_t));
+  if (num_features == kmdz_magic) {
+    // Read the header and the size of every block, the blocks follow.
+    size_t num_blocks;
+    compressed = true;
+    file.read((char *) &num_features, sizeof(size_t));
+    file.read((char *) &num_vectors, sizeof(size_t));
+    file.read((char *) &block_vectors, sizeof(size_t));
+    file.read((char *) &num_blocks, sizeof(size_t));
+    if (!file.good() || (block_vectors == 0) || (num_blocks != (num_vectors + block_vectors - 1) / block_vectors)) {
+      throw std::runtime_error("Corrupt compressed data set header.");
+    }
+    block_sizes.resize(num_blocks);
+    file.read((char *) block_sizes.data(), num_blocks * sizeof(size_t));
+  } else {
+    file.read((char *) &num_vectors, sizeof(size_t));
+  }
+  if (!file.good()) {
+    throw std::runtime_error("Data set file is truncated.");
+  }
+}
+
+void DataSetReader::decompressNextBlock() {
+  auto first = next_block * block_vectors;
+  block_count = std::min(block_vectors, num_vectors - first);
+  block_position = 0;
+  block_data.resize(block_sizes[next_block]);
+  file.read((char *) block_data.data(), block_data.size());
+  if (!file.good()) {
+    throw std::runtime_error("Compressed data set is truncated.");
+  }
+  block_values.resize(block_count * num_features);
+  decompressBlock(block_data.data(), block_data.size(), block_values.data(), block_count, num_features, scratch);
+  next_block++;
+}
+
+size_t DataSetReader::read(DataSet &batch, size_t max_vectors) {
+  auto count = std::min(max_vectors, num_vectors - position);
+  batch.num_features = num_features;
+  batch.resize(count);
+  if (compressed) {
+    // Copy the vectors from the decompressed blocks.
+    size_t filled = 0;
+    while (filled < count) {
+      if (block_position == block_count) {
+        decompressNextBlock();
+      }
+      auto n = std::min(count - filled, block_count - block_position);
+      std::copy(&block_values[block_position * num_features], &block_values[(block_position + n) * num_features],
+                batch.vector(filled));
+      block_position += n;
+      filled += n;
+    }
+  } else {
+    file.read((char *) batch.vector(0), count * num_features * sizeof(float));
+    if (!file.good()) {
+      throw std::runtime_error("Data set file is truncated.");
+    }
+  }
+  position += count;
+  return count;
+}
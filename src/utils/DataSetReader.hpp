@@ -0,0 +1,84 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "DataSet.hpp"
+
+/**
+ * @brief Reads a data set file in batches, without loading it completely.
+ *
+ * The raw and the compressed .kmd format are supported. Compressed files are decompressed one block at a time. CSV
+ * files are not supported.
+ */
+struct DataSetReader {
+  ///@brief The number of features of every vector in the file.
+  size_t num_features = 0;
+
+  ///@brief The total number of vectors in the file.
+  size_t num_vectors = 0;
+
+  ///@brief The number of vectors read so far.
+  size_t position = 0;
+
+  ///@brief Open a data set file and read its header.
+  explicit DataSetReader(const std::string &file_name);
+
+  /**
+   * @brief Read the next batch of vectors.
+   *
+   * @param batch         The data set to read the vectors into. Its storage is reused.
+   * @param max_vectors   The maximum number of vectors to read.
+   * @return The number of vectors read. Zero when the end of the file was reached.
+   */
+  size_t read(DataSet &batch, size_t max_vectors);
+
+ private:
+  std::ifstream file;
+
+  ///@brief Whether the file is in the compressed format.
+  bool compressed = false;
+
+  ///@brief The number of vectors per block of a compressed file.
+  size_t block_vectors = 0;
+
+  ///@brief The size of every block of a compressed file.
+  std::vector<size_t> block_sizes;
+
+  ///@brief The index of the next block to decompress.
+  size_t next_block = 0;
+
+  ///@brief The compressed data of the current block.
+  std::vector<uint8_t> block_data;
+
+  ///@brief Scratch space for the decompression.
+  std::vector<uint8_t> scratch;
+
+  ///@brief The feature values of the current block.
+  std::vector<float> block_values;
+
+  ///@brief The number of vectors in the current block.
+  size_t block_count = 0;
+
+  ///@brief The number of vectors of the current block that were read.
+  size_t block_position = 0;
+
+  ///@brief Read and decompress the next block of a compressed file.
+  void decompressNextBlock();
+};
@@ -31,19 +31,27 @@ void FeatureVec::clear() {
 }
 
 std::string FeatureVec::toString() {
+  return featuresToString(values.data(), values.size());
+}
+
+std::string featuresToString(const float *values, size_t num_features) {
   std::string str;
-  for (size_t f = 0; f < values.size(); f++) {
+  for (size_t f = 0; f < num_features; f++) {
     str += std::to_string(values[f]);
-    str += f < values.size() - 1 ? ", " : "";
+    str += f < num_features - 1 ? ", " : "";
   }
   return str;
 }
 
-float calculateEuclideanDistance(FeatureVec a, FeatureVec b) {
+float calculateEuclideanDistance(const FeatureVec &a, const FeatureVec &b) {
   assert(a.size() == b.size());
+  return calculateEuclideanDistance(a.values.data(), b.values.data(), a.size());
+}
+
+float calculateEuclideanDistance(const float *a, const float *b, size_t num_features) {
   float dist = 0.0f;
   // Loop over all features
-  for (size_t f = 0; f < a.size(); f++) {
+  for (size_t f = 0; f < num_features; f++) {
     // Accumulate the squared difference
     dist += std::pow(a[f] - b[f], 2);
   }
@@ -51,4 +51,16 @@ struct FeatureVec {
  * @param b Another vector
  * @return The Euclidean Distance
  */
-float calculateEuclideanDistance(FeatureVec a, FeatureVec b);
\ No newline at end of file
+float calculateEuclideanDistance(const FeatureVec &a, const FeatureVec &b);
+
+/**
+ * Calculate the Euclidean distance between the features at A and B
+ * @param a             Features of a vector
+ * @param b             Features of another vector
+ * @param num_features  The number of features
+ * @return The Euclidean Distance
+ */
+float calculateEuclideanDistance(const float *a, const float *b, size_t num_features);
+
+///@brief Convert \p num_features features at \p values to a comma-separated string.
+std::string featuresToString(const float *values, size_t num_features);
\ No newline at end of file
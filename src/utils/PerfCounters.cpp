@@ -0,0 +1,149 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+// Open a counter of the calling process on any CPU, or return -1 when it is not available.
+static int openCounter(uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // Counters may be multiplexed when there are not enough hardware counters, so keep track of the time they ran.
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Read a counter, scaled up for the time it was not running.
+static uint64_t readCounter(int fd) {
+  if (fd < 0) return 0;
+  uint64_t values[3];
+  if (::read(fd, values, sizeof(values)) != (ssize_t) sizeof(values) || values[2] == 0) {
+    return 0;
+  }
+  if (values[1] == values[2]) return values[0];
+  return (uint64_t) ((double) values[0] * (double) values[1] / (double) values[2]);
+}
+#endif
+
+PerfCounters::Reading &PerfCounters::Reading::operator+=(const Reading &other) {
+  seconds += other.seconds;
+  cycles += other.cycles;
+  instructions += other.instructions;
+  llc_misses += other.llc_misses;
+  return *this;
+}
+
+PerfCounters::Reading PerfCounters::Reading::operator-(const Reading &other) const {
+  Reading result;
+  result.seconds = seconds - other.seconds;
+  result.cycles = cycles - other.cycles;
+  result.instructions = instructions - other.instructions;
+  result.llc_misses = llc_misses - other.llc_misses;
+  return result;
+}
+
+PerfCounters::PerfCounters() : origin(std::chrono::high_resolution_clock::now()) {
+#ifdef __linux__
+  cycles_fd = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  instructions_fd = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  llc_misses_fd = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  // Not all processors count last-level cache misses as a cache event, fall back to the generic event.
+  if (llc_misses_fd < 0) {
+    llc_misses_fd = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (auto fd : {cycles_fd, instructions_fd, llc_misses_fd}) {
+    if (fd >= 0) close(fd);
+  }
+#endif
+}
+
+PerfCounters::Reading PerfCounters::read() const {
+  Reading r;
+  Timer::duration elapsed = std::chrono::high_resolution_clock::now() - origin;
+  r.seconds = elapsed.count();
+#ifdef __linux__
+  r.cycles = readCounter(cycles_fd);
+  r.instructions = readCounter(instructions_fd);
+  r.llc_misses = readCounter(llc_misses_fd);
+#endif
+  return r;
+}
+
+PerfCounters::Reading PerfProfile::end(const char *name, const PerfCounters::Reading &begin) {
+  auto now = counters.read();
+  Phase *phase = nullptr;
+  for (auto &p : phases) {
+    if (std::strcmp(p.name, name) == 0) {
+      phase = &p;
+      break;
+    }
+  }
+  if (phase == nullptr) {
+    phases.push_back(Phase{name, 0, PerfCounters::Reading()});
+    phase = &phases.back();
+  }
+  phase->calls++;
+  phase->total += now - begin;
+  return now;
+}
+
+void PerfProfile::report(std::ostream &os) const {
+  if (!counters.available()) {
+    os << "Hardware counters are not available, reporting time only." << std::endl;
+  }
+
+  os << std::left << std::setw(26) << "Phase" << std::right << std::setw(8) << "Calls" << std::setw(14) << "Time (s)";
+  if (counters.hasCycles()) os << std::setw(16) << "Cycles";
+  if (counters.hasInstructions()) os << std::setw(16) << "Instructions";
+  if (counters.hasCycles() && counters.hasInstructions()) os << std::setw(8) << "IPC";
+  if (counters.hasLlcMisses()) os << std::setw(14) << "LLC misses" << std::setw(12) << "Est. GB/s";
+  os << std::endl;
+
+  for (auto &p : phases) {
+    auto &t = p.total;
+    os << std::left << std::setw(26) << p.name << std::right << std::setw(8) << p.calls << std::setw(14) << t.seconds;
+    if (counters.hasCycles()) os << std::setw(16) << t.cycles;
+    if (counters.hasInstructions()) os << std::setw(16) << t.instructions;
+    if (counters.hasCycles() && counters.hasInstructions()) {
+      os << std::setw(8) << std::setprecision(3) << (t.cycles != 0 ? (double) t.instructions / (double) t.cycles : 0.0)
+         << std::setprecision(6);
+    }
+    if (counters.hasLlcMisses()) {
+      os << std::setw(14) << t.llc_misses << std::setw(12) << std::setprecision(3)
+         << (t.seconds > 0.0 ? (double) t.llc_misses * 64.0 / t.seconds * 1e-9 : 0.0) << std::setprecision(6);
+    }
+    os << std::endl;
+  }
+}
@@ -0,0 +1,123 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "Timer.hpp"
+
+/**
+ * @brief Hardware performance counters of the calling process, using perf_event_open.
+ *
+ * The counters are opened with inheritance, so threads that are created after construction are counted as well.
+ * Construct the counters before the first OpenMP parallel region to include the OpenMP worker threads.
+ *
+ * When the kernel does not allow access to some counter, for example in a container or virtual machine, that counter
+ * reads as zero and is reported as unavailable. The wall-clock time is always measured.
+ */
+struct PerfCounters {
+  ///@brief A reading of all counters.
+  struct Reading {
+    ///@brief The wall-clock time in seconds.
+    double seconds = 0.0;
+    ///@brief The number of CPU cycles.
+    uint64_t cycles = 0;
+    ///@brief The number of retired instructions.
+    uint64_t instructions = 0;
+    ///@brief The number of last-level cache misses.
+    uint64_t llc_misses = 0;
+
+    ///@brief Add the counts of \p other to this reading.
+    Reading &operator+=(const Reading &other);
+    ///@brief Return the counts between the earlier reading \p other and this one.
+    Reading operator-(const Reading &other) const;
+  };
+
+  ///@brief Open the counters.
+  PerfCounters();
+
+  ///@brief Close the counters.
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  ///@brief Read all counters.
+  Reading read() const;
+
+  ///@brief Return whether the cycles counter is available.
+  bool hasCycles() const { return cycles_fd >= 0; }
+
+  ///@brief Return whether the instructions counter is available.
+  bool hasInstructions() const { return instructions_fd >= 0; }
+
+  ///@brief Return whether the last-level cache misses counter is available.
+  bool hasLlcMisses() const { return llc_misses_fd >= 0; }
+
+  ///@brief Return whether any hardware counter is available.
+  bool available() const { return hasCycles() || hasInstructions() || hasLlcMisses(); }
+
+ private:
+  int cycles_fd = -1;
+  int instructions_fd = -1;
+  int llc_misses_fd = -1;
+  Timer::time_point origin;
+};
+
+/**
+ * @brief Hardware counters and time accumulated per phase of the program.
+ *
+ * A phase is measured between two readings of the counters. Phases may be nested, since measuring one phase does not
+ * disturb the readings held for another. Measuring a phase does not allocate once it has been measured before.
+ */
+struct PerfProfile {
+  ///@brief The accumulated counts of a single phase.
+  struct Phase {
+    ///@brief The name of the phase.
+    const char *name;
+    ///@brief The number of times the phase was measured.
+    size_t calls;
+    ///@brief The total counts of all measurements.
+    PerfCounters::Reading total;
+  };
+
+  ///@brief The counters to read.
+  PerfCounters counters;
+
+  ///@brief The phases in the order in which they were first measured.
+  std::vector<Phase> phases;
+
+  ///@brief Read the counters at the start of a phase.
+  PerfCounters::Reading begin() const { return counters.read(); }
+
+  /**
+   * @brief Add the counts since \p begin to the phase named \p name.
+   *
+   * @param name  The name of the phase. Must remain valid as long as the profile, e.g. a string literal.
+   * @param begin The reading at the start of the phase.
+   * @return The reading at the end of the phase, which may be used as the start of the next phase.
+   */
+  PerfCounters::Reading end(const char *name, const PerfCounters::Reading &begin);
+
+  /**
+   * @brief Print the counts of all phases.
+   *
+   * Besides the raw counts, the instructions per cycle and an estimate of the memory bandwidth are printed. The memory
+   * bandwidth is estimated as one 64-byte cache line per last-level cache miss.
+   */
+  void report(std::ostream &os = std::cout) const;
+};
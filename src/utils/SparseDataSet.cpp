@@ -0,0 +1,148 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+#include "SparseDataSet.hpp"
+#include "RandomGenerator.hpp"
+
+void SparseDataSet::addVector(const std::vector<uint32_t> &idx, const std::vector<float> &vals) {
+  if (idx.size() != vals.size()) {
+    throw std::runtime_error("Sparse feature vector has a different number of indices than values.");
+  }
+  for (size_t i = 0; i < idx.size(); i++) {
+    if ((idx[i] >= num_features) || ((i > 0) && (idx[i] <= idx[i - 1]))) {
+      throw std::runtime_error("Sparse feature vector indices are out of range or not sorted.");
+    }
+  }
+  indices.insert(indices.end(), idx.begin(), idx.end());
+  values.insert(values.end(), vals.begin(), vals.end());
+  offsets.push_back(values.size());
+}
+
+void SparseDataSet::toFile(const std::string &file_name) {
+  std::ofstream file(file_name, std::ios::binary);
+
+  if (file.good()) {
+    auto s = size();
+    auto nnz = nonZeros();
+    file.write((char *) &kms_magic, sizeof(uint64_t));
+    file.write((char *) &num_features, sizeof(size_t));
+    file.write((char *) &s, sizeof(size_t));
+    file.write((char *) &nnz, sizeof(size_t));
+    file.write((char *) offsets.data(), offsets.size() * sizeof(size_t));
+    file.write((char *) indices.data(), indices.size() * sizeof(uint32_t));
+    file.write((char *) values.data(), values.size() * sizeof(float));
+  } else {
+    throw std::runtime_error("Could not write to file.");
+  }
+}
+
+std::shared_ptr<SparseDataSet> SparseDataSet::fromFile(const std::string &file_name) {
+  auto ds = std::make_shared<SparseDataSet>();
+
+  std::ifstream file(file_name, std::ios::binary);
+
+  if (file.good()) {
+    uint64_t magic;
+    size_t size;
+    size_t nnz;
+    file.read((char *) &magic, sizeof(uint64_t));
+    if (magic != kms_magic) {
+      throw std::runtime_error("Not a sparse data set file.");
+    }
+    file.read((char *) &ds->num_features, sizeof(size_t));
+    file.read((char *) &size, sizeof(size_t));
+    file.read((char *) &nnz, sizeof(size_t));
+
+    ds->offsets.resize(size + 1);
+    ds->indices.resize(nnz);
+    ds->values.resize(nnz);
+    file.read((char *) ds->offsets.data(), ds->offsets.size() * sizeof(size_t));
+    file.read((char *) ds->indices.data(), ds->indices.size() * sizeof(uint32_t));
+    file.read((char *) ds->values.data(), ds->values.size() * sizeof(float));
+    if (!file.good() || (ds->offsets.front() != 0) || (ds->offsets.back() != nnz)) {
+      throw std::runtime_error("Sparse data set file is corrupt or truncated.");
+    }
+    // Validate every vector like addVector does, the clustering indexes centroids with these.
+    for (size_t v = 0; v < size; v++) {
+      if (ds->offsets[v + 1] < ds->offsets[v]) {
+        throw std::runtime_error("Sparse data set file has decreasing offsets.");
+      }
+      for (auto i = ds->offsets[v]; i < ds->offsets[v + 1]; i++) {
+        if ((ds->indices[i] >= ds->num_features) || ((i > ds->offsets[v]) && (ds->indices[i] <= ds->indices[i - 1]))) {
+          throw std::runtime_error("Sparse feature vector indices are out of range or not sorted.");
+        }
+      }
+    }
+    return ds;
+  } else {
+    throw std::runtime_error("Could not load from file");
+  }
+}
+
+bool SparseDataSet::isSparseFile(const std::string &file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  uint64_t magic = 0;
+  file.read((char *) &magic, sizeof(uint64_t));
+  return file.good() && (magic == kms_magic);
+}
+
+std::shared_ptr<SparseDataSet> SparseDataSet::random(size_t num_features,
+                                                     size_t num_vectors,
+                                                     float density,
+                                                     int num_clusters) {
+  UniformRandomGenerator<long> rg(1);
+  NormalRandomGenerator<float> nrg(1);
+
+  auto nnz = std::max((size_t) 1, (size_t) (density * num_features));
+  auto pool_size = std::min(num_features, 4 * nnz);
+  num_clusters = std::max(num_clusters, 1);
+
+  // Every cluster gets its own pool of features to draw non-zeros from.
+  std::vector<uint32_t> all(num_features);
+  std::iota(all.begin(), all.end(), 0);
+  std::vector<std::vector<uint32_t>> pools(num_clusters);
+  for (auto &pool : pools) {
+    for (size_t i = 0; i < pool_size; i++) {
+      std::swap(all[i], all[i + rg.next() % (num_features - i)]);
+    }
+    pool.assign(all.begin(), all.begin() + pool_size);
+  }
+
+  auto ds = std::make_shared<SparseDataSet>(num_features);
+  ds->offsets.reserve(num_vectors + 1);
+  ds->indices.reserve(num_vectors * nnz);
+  ds->values.reserve(num_vectors * nnz);
+
+  std::vector<uint32_t> indices(nnz);
+  std::vector<float> values(nnz);
+  for (size_t v = 0; v < num_vectors; v++) {
+    auto &pool = pools[v % num_clusters];
+    // Draw distinct features from the pool of this cluster.
+    for (size_t i = 0; i < nnz; i++) {
+      std::swap(pool[i], pool[i + rg.next() % (pool_size - i)]);
+    }
+    std::copy(pool.begin(), pool.begin() + nnz, indices.begin());
+    std::sort(indices.begin(), indices.end());
+    for (auto &value : values) {
+      value = 1.0f + 0.25f * nrg.next();
+    }
+    ds->addVector(indices, values);
+  }
+  return ds;
+}
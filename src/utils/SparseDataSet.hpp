@@ -0,0 +1,82 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <string>
+
+///@brief Magic number at the start of a sparse data set file ("KMS", version 1).
+constexpr uint64_t kms_magic = 0x00000001534D4BULL;
+
+/**
+ * @brief A data set with sparse vectors, stored in compressed sparse row (CSR) format.
+ *
+ * The non-zero features of vector v are at positions offsets[v] up to offsets[v + 1] of the indices and values.
+ * Feature indices within a vector are sorted in ascending order.
+ */
+struct SparseDataSet {
+  size_t num_features = 0;
+
+  ///@brief The position of the first non-zero of each vector, with one extra entry holding the total.
+  std::vector<size_t> offsets = {0};
+
+  ///@brief The feature indices of the non-zeros.
+  std::vector<uint32_t> indices;
+
+  ///@brief The feature values of the non-zeros.
+  std::vector<float> values;
+
+  ///@brief Construct a new sparse data set with \p num_features features in the feature vectors.
+  explicit SparseDataSet(size_t num_features = 1) : num_features(num_features) {};
+
+  /**
+   * @brief         Add a sparse feature vector to the data set.
+   * @param indices The sorted feature indices of the non-zeros.
+   * @param values  The values of the non-zeros.
+   */
+  void addVector(const std::vector<uint32_t> &indices, const std::vector<float> &values);
+
+  ///@brief Return the number of feature vectors in the data set.
+  inline size_t size() const { return offsets.size() - 1; }
+
+  ///@brief Return the total number of non-zeros in the data set.
+  inline size_t nonZeros() const { return values.size(); }
+
+  ///@brief Write the SparseDataSet to file
+  void toFile(const std::string &file_name);
+
+  ///@brief Load a SparseDataSet from a file
+  static std::shared_ptr<SparseDataSet> fromFile(const std::string &file_name);
+
+  ///@brief Return whether \p file_name holds a sparse data set.
+  static bool isSparseFile(const std::string &file_name);
+
+  /**
+   * @brief Create a random SparseDataSet.
+   *
+   * Every cluster draws its non-zeros from its own random subset of the features.
+   *
+   * @param num_features    The number of features.
+   * @param num_vectors     The number of vectors.
+   * @param density         The fraction of non-zero features per vector.
+   * @param num_clusters    The number of clusters to generate vectors around.
+   */
+  static std::shared_ptr<SparseDataSet> random(size_t num_features,
+                                               size_t num_vectors,
+                                               float density,
+                                               int num_clusters = 1);
+};
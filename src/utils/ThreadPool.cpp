@@ -0,0 +1,117 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+static thread_local int worker_index = -1;
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  for (size_t t = 0; t < num_threads; t++) {
+    queues.emplace_back(new Queue);
+  }
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back(&ThreadPool::work, this, t);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_available.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  auto &queue = *queues[next_queue++ % queues.size()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued++;
+    pending++;
+  }
+  work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  all_done.wait(lock, [this] { return pending == 0; });
+}
+
+int ThreadPool::workerIndex() {
+  return worker_index;
+}
+
+bool ThreadPool::take(size_t index, Task &task) {
+  // Take the most recently submitted task from our own queue.
+  {
+    auto &own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  // Steal the oldest task of some other worker.
+  for (size_t i = 1; i < queues.size(); i++) {
+    auto &other = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::work(size_t index) {
+  worker_index = (int) index;
+  Task task;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      work_available.wait(lock, [this] { return (queued > 0) || stopping; });
+      if (queued == 0) return;
+      // Claim a task, it is guaranteed to be in one of the queues.
+      queued--;
+    }
+
+    while (!take(index, task)) {
+      std::this_thread::yield();
+    }
+    task();
+    task = nullptr;
+
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = --pending == 0;
+    }
+    if (done) all_done.notify_all();
+  }
+}
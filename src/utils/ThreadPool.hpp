@@ -0,0 +1,78 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A work-stealing thread pool.
+ *
+ * Every worker has its own task queue. Submitted tasks are distributed over the queues round-robin. A worker takes
+ * tasks from the back of its own queue, and when that runs dry, steals from the front of the queues of other workers.
+ */
+struct ThreadPool {
+  using Task = std::function<void()>;
+
+  ///@brief Construct a new thread pool with \p num_threads workers. Zero selects the number of hardware threads.
+  explicit ThreadPool(size_t num_threads = 0);
+
+  ///@brief Finish all submitted tasks and join the workers.
+  ~ThreadPool();
+
+  ///@brief Submit a task to the pool.
+  void submit(Task task);
+
+  ///@brief Block until all submitted tasks have finished.
+  void wait();
+
+  ///@brief Return the number of workers.
+  inline size_t size() const { return threads.size(); }
+
+  ///@brief Return the index of the calling worker, or -1 if not called from a worker of any pool.
+  static int workerIndex();
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  ///@brief Take a task from the queue of worker \p index, or steal one from another worker.
+  bool take(size_t index, Task &task);
+
+  ///@brief The main loop of worker \p index.
+  void work(size_t index);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable work_available;
+  std::condition_variable all_done;
+  ///@brief Number of tasks in the queues.
+  size_t queued = 0;
+  ///@brief Number of tasks submitted but not yet finished.
+  size_t pending = 0;
+  bool stopping = false;
+
+  std::atomic<size_t> next_queue{0};
+};
@@ -0,0 +1,65 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../src/krazy/KrazyMeans.hpp"
+#include "../src/krazy/SparseKrazyMeans.hpp"
+#include "../src/utils/Allocations.hpp"
+
+// Check that the iterations of the algorithm don't allocate after the first one, for every assignment strategy.
+int main() {
+  if (!countingAllocations()) {
+    std::cerr << "Heap allocations are not counted." << std::endl;
+    return 1;
+  }
+
+  int failures = 0;
+  auto ds = DataSet::random(3, 20000, 8);
+
+  for (auto assignment : {KrazyMeans::Assignment::Naive, KrazyMeans::Assignment::KdTree}) {
+    for (unsigned int threads : {1u, 4u}) {
+      KrazyMeans km(ds, 8, 16, 1e-3f);
+      km.assignment = assignment;
+      km.num_threads = threads;
+      km.stopping.max_centroid_shift = 1e-6f;
+      km.initialize();
+      km.run();
+      if (km.loop_allocations != 0) {
+        std::cerr << "KrazyMeans with the " << (km.use_kd_tree ? "k-d tree" : "naive assignment") << " on "
+                  << threads << " threads allocated " << km.loop_allocations << " times in its iterations."
+                  << std::endl;
+        failures++;
+      }
+    }
+  }
+
+  // The sparse centroid update reuses its scratch memory.
+  auto sparse = SparseDataSet::random(64, 5000, 0.1f, 8);
+  SparseKrazyMeans skm(sparse, 8, 16, 1e-3f);
+  skm.initialize();
+  skm.iterate();
+  auto allocations = heapAllocations();
+  skm.iterate();
+  if (heapAllocations() != allocations) {
+    std::cerr << "SparseKrazyMeans allocated " << heapAllocations() - allocations << " times in an iteration."
+              << std::endl;
+    failures++;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
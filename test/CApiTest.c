@@ -0,0 +1,95 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "krazymeans.h"
+
+#define NUM_VECTORS 3000
+#define NUM_FEATURES 3
+#define STRIDE 5
+#define NUM_CLUSTERS 5
+
+static int failures = 0;
+
+static void check(int condition, const char *what) {
+  if (!condition) {
+    fprintf(stderr, "Failed: %s\n", what);
+    failures++;
+  }
+}
+
+/* Cluster the same vectors in a strided and in a contiguous buffer, and check the C API reports the same results. */
+int main(void) {
+  static float strided[NUM_VECTORS * STRIDE];
+  static float contiguous[NUM_VECTORS * NUM_FEATURES];
+  static size_t labels[2][NUM_VECTORS];
+  static float centroids[2][NUM_CLUSTERS * NUM_FEATURES];
+  km_options options;
+  km_result results[2];
+  size_t v, f;
+  int a;
+
+  srand(1);
+  for (v = 0; v < NUM_VECTORS; v++) {
+    for (f = 0; f < NUM_FEATURES; f++) {
+      float value = (float) (v % NUM_CLUSTERS) * 4.0f + (float) rand() / (float) RAND_MAX;
+      strided[v * STRIDE + f] = value;
+      contiguous[v * NUM_FEATURES + f] = value;
+    }
+  }
+
+  km_options_init(&options, sizeof(options));
+  check(options.struct_size == sizeof(options), "km_options_init sets the struct size");
+  options.num_clusters = NUM_CLUSTERS;
+  options.num_threads = 1;
+
+  for (a = KM_ASSIGNMENT_NAIVE; a <= KM_ASSIGNMENT_KD_TREE; a++) {
+    options.assignment = (km_assignment) a;
+    results[0].struct_size = sizeof(km_result);
+    results[1].struct_size = sizeof(km_result);
+    check(km_cluster(strided, NUM_VECTORS, NUM_FEATURES, STRIDE, &options, labels[0], centroids[0], &results[0])
+              == KM_OK, "clustering a strided buffer");
+    check(km_cluster(contiguous, NUM_VECTORS, NUM_FEATURES, NUM_FEATURES, &options, labels[1], centroids[1],
+                     &results[1]) == KM_OK, "clustering a contiguous buffer");
+    check(memcmp(labels[0], labels[1], sizeof(labels[0])) == 0, "strided and contiguous labels are equal");
+    check(memcmp(centroids[0], centroids[1], sizeof(centroids[0])) == 0, "strided and contiguous centroids are equal");
+    check(results[0].iterations == results[1].iterations, "strided and contiguous iterations are equal");
+    check(results[0].stop_reason == KM_STOP_CONVERGED, "the clustering converges");
+  }
+
+  /* Stopping rules. */
+  options.assignment = KM_ASSIGNMENT_NAIVE;
+  options.scale_threshold_iterations = 1000;
+  options.max_iterations = 1;
+  options.seed = 3;
+  check(km_cluster(contiguous, NUM_VECTORS, NUM_FEATURES, NUM_FEATURES, &options, NULL, NULL, &results[0]) == KM_OK,
+        "clustering with an iteration limit");
+  check((results[0].iterations == 1) &&
+            ((results[0].stop_reason == KM_STOP_MAX_ITERATIONS) || (results[0].stop_reason == KM_STOP_CONVERGED)),
+        "the iteration limit stops the clustering");
+
+  /* Invalid arguments. */
+  check(km_cluster(NULL, NUM_VECTORS, NUM_FEATURES, NUM_FEATURES, &options, NULL, NULL, NULL)
+            == KM_ERROR_INVALID_ARGUMENT, "a null buffer is rejected");
+  check(km_cluster(contiguous, NUM_VECTORS, NUM_FEATURES, NUM_FEATURES - 1, &options, NULL, NULL, NULL)
+            == KM_ERROR_INVALID_ARGUMENT, "a stride below the number of features is rejected");
+  options.struct_size = 0;
+  check(km_cluster(contiguous, NUM_VECTORS, NUM_FEATURES, NUM_FEATURES, &options, NULL, NULL, NULL)
+            == KM_ERROR_INVALID_ARGUMENT, "options without a size are rejected");
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/utils/Compression.hpp"
+#include "../src/utils/DataSet.hpp"
+#include "../src/utils/DataSetReader.hpp"
+#include "../src/utils/RandomGenerator.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "Failed: " << what << std::endl;
+    failures++;
+  }
+}
+
+// Return whether the vectors of two data sets are bitwise equal.
+static bool equal(DataSet &a, DataSet &b) {
+  if ((a.size() != b.size()) || (a.num_features != b.num_features)) return false;
+  for (size_t v = 0; v < a.size(); v++) {
+    if (std::memcmp(a.vector(v), b.vector(v), a.num_features * sizeof(float)) != 0) return false;
+  }
+  return true;
+}
+
+// Write a data set compressed, and check that loading it and reading it in batches restores it exactly.
+static void roundTrip(DataSet &ds, size_t block_vectors, const std::string &what) {
+  const std::string file_name = "compression_test.kmdz";
+  ds.toCompressedFile(file_name, block_vectors);
+
+  auto loaded = DataSet::fromFile(file_name);
+  check(equal(ds, *loaded), what + ": load");
+
+  DataSetReader reader(file_name);
+  DataSet all(ds.num_features);
+  DataSet batch;
+  while (reader.read(batch, 777) > 0) {
+    all.append(batch.vector(0), batch.size());
+  }
+  check(equal(ds, all), what + ": read in batches");
+  std::remove(file_name.c_str());
+}
+
+// Return whether decompressing a block throws.
+static bool rejects(const std::vector<uint8_t> &block, size_t num_vectors, size_t num_features) {
+  std::vector<float> out(num_vectors * num_features);
+  std::vector<uint8_t> scratch;
+  try {
+    decompressBlock(block.data(), block.size(), out.data(), num_vectors, num_features, scratch);
+  } catch (std::runtime_error &e) {
+    return true;
+  }
+  return false;
+}
+
+// Check the compressed format: round trips, and rejection of truncated and corrupt data.
+int main() {
+  // Contiguous data, with a last block that is not full.
+  auto ds = DataSet::random(5, 10000, 4);
+  roundTrip(*ds, 4096, "contiguous");
+  roundTrip(*ds, 1, "one vector per block");
+
+  // Strided data, borrowed from a buffer with padding after every vector.
+  std::vector<float> padded(1000 * 8, -1.0f);
+  for (size_t v = 0; v < 1000; v++) {
+    std::copy(ds->vector(v), ds->vector(v) + 5, &padded[v * 8]);
+  }
+  auto strided = DataSet::wrap(padded.data(), 1000, 5, 8);
+  roundTrip(*strided, 300, "strided");
+
+  // Special values and long runs, which the LZ codec compresses.
+  DataSet runs(3);
+  runs.resize(5000);
+  for (size_t v = 0; v < runs.size(); v++) {
+    runs.vector(v)[0] = (float) (v / 100);
+    runs.vector(v)[1] = v % 7 == 0 ? -0.0f : 1.0f / 0.0f;
+    runs.vector(v)[2] = 0.0f / 0.0f;
+  }
+  roundTrip(runs, 16384, "runs");
+
+  // No vectors at all.
+  DataSet empty(4);
+  roundTrip(empty, 16384, "empty");
+
+  // Blocks are shrunk so that the size of every byte plane fits in 32 bits.
+  DataSet wide(262144);
+  wide.resize(2);
+  roundTrip(wide, 16384, "wide");
+  wide.toCompressedFile("compression_test.kmdz");
+  std::ifstream header("compression_test.kmdz", std::ios::binary);
+  size_t fields[4];
+  header.read((char *) fields, sizeof(fields));
+  check(fields[3] * 262144 < (1ULL << 32), "wide: block size");
+  std::remove("compression_test.kmdz");
+
+  // Truncated and corrupt blocks.
+  std::vector<uint8_t> block;
+  compressBlock(runs.vector(0), runs.size(), runs.num_features, block);
+  check(!rejects(block, runs.size(), runs.num_features), "intact block");
+  for (size_t size : {(size_t) 0, (size_t) 3, (size_t) 5, block.size() / 2, block.size() - 1}) {
+    std::vector<uint8_t> truncated(block.begin(), block.begin() + size);
+    check(rejects(truncated, runs.size(), runs.num_features), "truncated to " + std::to_string(size) + " bytes");
+  }
+  auto bad_method = block;
+  bad_method[0] = 7;
+  check(rejects(bad_method, runs.size(), runs.num_features), "unknown method");
+  auto bad_size = block;
+  bad_size[4] = 0x7F;
+  check(rejects(bad_size, runs.size(), runs.num_features), "plane size beyond the block");
+  check(rejects(block, runs.size() + 1, runs.num_features), "wrong number of vectors");
+
+  // Random corruption must be rejected or decoded, but never read or write out of bounds.
+  UniformRandomGenerator<long> rg(3);
+  for (int trial = 0; trial < 2000; trial++) {
+    auto corrupt = block;
+    for (int i = 0; i < 4; i++) {
+      corrupt[(size_t) rg.next() % corrupt.size()] = (uint8_t) rg.next();
+    }
+    rejects(corrupt, runs.size(), runs.num_features);
+  }
+
+  // A truncated file.
+  runs.toCompressedFile("compression_test.kmdz", 1000);
+  std::ifstream in("compression_test.kmdz", std::ios::binary | std::ios::ate);
+  std::vector<char> bytes((size_t) in.tellg());
+  in.seekg(0);
+  in.read(bytes.data(), bytes.size());
+  in.close();
+  std::ofstream out("compression_test.kmdz", std::ios::binary);
+  out.write(bytes.data(), bytes.size() - 10);
+  out.close();
+  bool threw = false;
+  try {
+    DataSet::fromFile("compression_test.kmdz");
+  } catch (std::runtime_error &e) {
+    threw = true;
+  }
+  check(threw, "truncated file");
+  std::remove("compression_test.kmdz");
+
+  return failures == 0 ? 0 : 1;
+}
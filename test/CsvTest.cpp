@@ -0,0 +1,68 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/utils/Csv.hpp"
+#include "../src/utils/DataSet.hpp"
+
+// Format the points like KrazyMeans::printState did before writeCsv, through std::to_string.
+static std::string formatExpected(DataSet &ds, const std::vector<size_t> &labels) {
+  std::stringstream ss;
+  for (size_t v = 0; v < ds.size(); v++) {
+    ss << v << ", " << labels[v];
+    for (size_t f = 0; f < ds.num_features; f++) {
+      ss << ", " << std::to_string(ds.vector(v)[f]);
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+// Check that writeCsv writes every line, formatted exactly like std::to_string, also when the lines span many chunks
+// and fewer threads run than requested.
+int main() {
+  auto ds = DataSet::random(3, 200000, 5);
+  std::vector<size_t> labels(ds->size());
+  for (size_t v = 0; v < ds->size(); v++) {
+    labels[v] = v % 7;
+  }
+
+  // Special and extreme values.
+  const float special[] = {0.0f, -0.0f, 0.5f, -1.25f, 1e-7f, 4.9999995e-7f, 5e-7f, 123456.789f, -1e15f, 3e38f,
+                           std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+                           std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+                           std::numeric_limits<float>::denorm_min()};
+  size_t v = 0;
+  for (auto value : special) {
+    ds->vector(v)[v % 3] = value;
+    v += 997;
+  }
+
+  std::stringstream out;
+  writeCsv(out, *ds, labels.data());
+  auto expected = formatExpected(*ds, labels);
+  if (out.str() != expected) {
+    std::cerr << "writeCsv wrote " << out.str().size() << " bytes instead of " << expected.size()
+              << ", or formatted values differently than std::to_string." << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../src/krazy/KdTree.hpp"
+#include "../src/krazy/KrazyMeans.hpp"
+#include "../src/utils/RandomGenerator.hpp"
+
+// Assign every vector exhaustively, exactly like KrazyMeans::findClosestCentroidIndex.
+static std::vector<size_t> assignExhaustively(DataSet &ds,
+                                              const std::vector<FeatureVec> &centroids,
+                                              float factor,
+                                              const std::vector<size_t> &labels) {
+  std::vector<size_t> result(ds.size());
+  for (size_t v = 0; v < ds.size(); v++) {
+    float closest = INFINITY;
+    size_t index = 0;
+    for (size_t c = 0; c < centroids.size(); c++) {
+      float dist = calculateEuclideanDistance(ds.vector(v), centroids[c].values.data(), ds.num_features);
+      if (labels[v] != c) {
+        dist = dist * factor;
+      }
+      if (dist < closest) {
+        closest = dist;
+        index = c;
+      }
+    }
+    result[v] = index;
+  }
+  return result;
+}
+
+// Check that the k-d tree assigns the same labels as the exhaustive search, also when distances are scaled.
+int main() {
+  UniformRandomGenerator<float> rg(1);
+  size_t mismatches = 0;
+
+  for (int trial = 0; trial < 300; trial++) {
+    size_t F = 1 + trial % 4;
+    size_t K = 2 + trial % 10;
+    auto ds = DataSet::random(F, 2000, (int) K);
+
+    KdTree tree;
+    tree.build(*ds);
+
+    std::vector<FeatureVec> centroids(K);
+    for (auto &centroid : centroids) {
+      auto v = ds->vector((size_t) (rg.next() * (float) (ds->size() - 1)));
+      centroid.values.assign(v, v + F);
+    }
+
+    std::vector<size_t> labels(ds->size(), 0);
+    std::vector<double> sums;
+    std::vector<size_t> counts;
+
+    // Two passes without scaling, followed by passes with growing scaling factors.
+    for (int pass = 0; pass < 8; pass++) {
+      float factor = pass < 2 ? 1.0f : 1.0f + rg.next();
+      auto expected = assignExhaustively(*ds, centroids, factor, labels);
+      tree.assign(centroids, factor, labels, sums, counts);
+      for (size_t v = 0; v < ds->size(); v++) {
+        if (labels[v] != expected[v]) mismatches++;
+      }
+      labels = expected;
+
+      // Move the centroids to the mean of their vectors, like KrazyMeans::updateCentroids, and shake them a little
+      // so that whole subtrees change label.
+      for (size_t c = 0; c < K; c++) {
+        for (size_t f = 0; f < F; f++) {
+          auto mean = counts[c] != 0 ? (float) (sums[c * F + f] / (double) counts[c]) : 0.0f;
+          centroids[c][f] = mean + 0.5f * (rg.next() - 0.5f);
+        }
+      }
+    }
+  }
+
+  if (mismatches != 0) {
+    std::cerr << "The k-d tree assigned " << mismatches << " labels differently than the exhaustive search."
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}